@@ -0,0 +1,128 @@
+// CuckooTable benchmark: a Zipfian mix of put() and get() calls against CuckooTable and against a
+// std::unordered_map split into 16 shards behind std::shared_mutex locks.
+// Usage: cuckoo_bench [keys=1000000] [operations per thread=2000000] [threads=hardware] [put ratio=0.5] [theta=0.99]
+#define EXDB_NO_MAIN
+#include "../main.cpp"
+
+#include <cmath>
+
+namespace {
+
+// Zipfian ranks over [0, n) after Gray et al., "Quickly generating billion-record synthetic
+// databases"; rank 0 is the most popular, and ranks are scattered over the key space by a hash
+class Zipfian {
+public:
+    Zipfian(uint64_t n, double theta) : n_(n), theta_(theta) {
+        for (uint64_t i = 1; i <= n; ++i) {
+            zetaN_ += 1.0 / std::pow(static_cast<double>(i), theta);
+        }
+        double zeta2 = 1.0 + 1.0 / std::pow(2.0, theta);
+        alpha_ = 1.0 / (1.0 - theta);
+        eta_ = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta2 / zetaN_);
+    }
+
+    uint64_t next(std::mt19937_64& random) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(random);
+        double uz = u * zetaN_;
+        uint64_t rank = uz < 1.0 ? 0
+                        : uz < 1.0 + std::pow(0.5, theta_)
+                            ? 1
+                            : static_cast<uint64_t>(static_cast<double>(n_) * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        return hashKey(std::to_string(std::min(rank, n_ - 1))) % n_;
+    }
+
+private:
+    uint64_t n_;
+    double theta_;
+    double zetaN_ = 0;
+    double alpha_ = 0;
+    double eta_ = 0;
+};
+
+class ShardedMap {
+public:
+    void put(const std::string& key, const std::string& value) {
+        Shard& shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.values[key] = value;
+    }
+
+    std::string get(const std::string& key) {
+        Shard& shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.values.find(key);
+        return it != shard.values.end() ? it->second : "Key not found";
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<std::string, std::string> values;
+    };
+
+    Shard& shardFor(const std::string& key) { return shards_[std::hash<std::string>{}(key) % shards_.size()]; }
+
+    std::array<Shard, 16> shards_;
+};
+
+// Run the workload on every thread and return the throughput in million operations per second
+template <typename Table>
+double run(Table& table, const std::vector<std::string>& keys, const Zipfian& zipfian, size_t operations,
+           unsigned threadCount, double putRatio) {
+    for (const std::string& key : keys) {
+        table.put(key, "initial-value-16");
+    }
+    std::atomic<size_t> found{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 random(t + 1);
+            std::uniform_real_distribution<double> coin(0.0, 1.0);
+            size_t hits = 0;
+            for (size_t i = 0; i < operations; ++i) {
+                const std::string& key = keys[zipfian.next(random)];
+                if (coin(random) < putRatio) {
+                    table.put(key, "updated-value-16");
+                } else {
+                    hits += table.get(key).size();
+                }
+            }
+            found += hits;  // Keeps the reads from being optimized away
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(operations * threadCount) / elapsed.count() / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t keyCount = argc > 1 ? std::stoull(argv[1]) : 1000000;
+    size_t operations = argc > 2 ? std::stoull(argv[2]) : 2000000;
+    unsigned threadCount = argc > 3 ? static_cast<unsigned>(std::stoul(argv[3])) : std::max(1u, std::thread::hardware_concurrency());
+    double putRatio = argc > 4 ? std::stod(argv[4]) : 0.5;
+    double theta = argc > 5 ? std::stod(argv[5]) : 0.99;
+    std::vector<std::string> keys;
+    keys.reserve(keyCount);
+    for (size_t i = 0; i < keyCount; ++i) {
+        keys.push_back("user:" + std::to_string(i));
+    }
+    Zipfian zipfian(keyCount, theta);
+    std::cout << keyCount << " keys, " << threadCount << " threads x " << operations << " operations, "
+              << putRatio * 100 << "% put, theta " << theta << std::endl;
+    {
+        CuckooTable table;
+        std::cout << "CuckooTable: " << run(table, keys, zipfian, operations, threadCount, putRatio) << " Mops/s"
+                  << std::endl;
+    }
+    {
+        ShardedMap table;
+        std::cout << "16 shards + std::shared_mutex: " << run(table, keys, zipfian, operations, threadCount, putRatio)
+                  << " Mops/s" << std::endl;
+    }
+    return 0;
+}
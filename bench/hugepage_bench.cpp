@@ -0,0 +1,50 @@
+// Huge page benchmark: random get() latency of an ArenaTable backed by 4KB pages, transparent huge
+// pages, and reserved 2MB huge pages (which fall back to transparent ones if none are reserved).
+// Usage: hugepage_bench [keys=8000000] [gets=1000000]
+#define EXDB_NO_MAIN
+#include "../main.cpp"
+
+namespace {
+
+const char* pageName(HugePages pages) {
+    switch (pages) {
+        case HugePages::None: return "4KB pages";
+        case HugePages::Transparent: return "transparent huge pages";
+        case HugePages::Explicit2MB: return "2MB huge pages";
+        case HugePages::Explicit1GB: return "1GB huge pages";
+    }
+    return "?";
+}
+
+void run(HugePages requested, size_t keyCount, size_t gets) {
+    ArenaTable table(-1, requested);
+    for (size_t i = 0; i < keyCount; ++i) {
+        table.put("user:" + std::to_string(i), "value-of-16-byte");
+    }
+    std::vector<std::string> probes;  // Built up front so only the lookups are timed
+    probes.reserve(gets);
+    std::mt19937_64 random(42);
+    for (size_t i = 0; i < gets; ++i) {
+        probes.push_back("user:" + std::to_string(random() % keyCount));
+    }
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& key : probes) {
+        found += table.get(key).size();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "requested " << pageName(requested) << ", using " << pageName(table.hugePages()) << ": "
+              << elapsed.count() / static_cast<double>(gets) << " ns/get (" << found << " bytes read)" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t keyCount = argc > 1 ? std::stoull(argv[1]) : 8000000;
+    size_t gets = argc > 2 ? std::stoull(argv[2]) : 1000000;
+    std::cout << keyCount << " keys, " << gets << " random gets" << std::endl;
+    for (HugePages pages : {HugePages::None, HugePages::Transparent, HugePages::Explicit2MB}) {
+        run(pages, keyCount, gets);
+    }
+    return 0;
+}
@@ -1,136 +1,6949 @@
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
 #include <fstream>
 #include <string>
 #include <shared_mutex>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <filesystem>
+#include <string_view>
+#include <new>
+#include <memory>
+#include <limits>
+#include <cmath>
+#include <stdexcept>
+#include <cctype>
+#include <deque>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <functional>
+#include <future>
+#include <tuple>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Checksum Utility: CRC-32 (IEEE) used to detect torn or corrupted on-disk records
+inline uint32_t crc32(const char* data, size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Hash Utility: FNV-1a (64-bit) for keys and contents. Stable across processes and builds, unlike
+// std::hash, so it may be stored on disk (hash snapshots, blob identifiers).
+inline uint64_t hashKey(std::string_view key) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : key) {
+        hash = (hash ^ c) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// I/O classes known to the scheduler, from highest to lowest priority
+enum class IOClass { WalSync = 0, Checkpoint = 1, Compaction = 2, Backup = 3 };
+
+// I/O Scheduler Module: Arbitrates disk bandwidth between foreground WAL I/O and background work.
+// WAL I/O is never delayed; background classes pass through per-class token buckets, yield while
+// WAL I/O is in flight, and are scaled down (AIMD) whenever WAL latency exceeds its budget.
+class IOScheduler {
+public:
+    static constexpr size_t kClassCount = 4;
+
+    // Per-class counters exposed to operators
+    struct Stats {
+        std::array<uint64_t, kClassCount> bytes{};            // Bytes admitted per class
+        std::array<uint64_t, kClassCount> throttledMicros{};  // Time spent waiting per class
+        double walLatencyMicros = 0;                          // Smoothed WAL I/O latency
+        double backgroundScale = 1.0;                         // Current fraction of background rate limits
+    };
+
+    // Constructor sets the WAL latency budget and default background rate limits
+    explicit IOScheduler(std::chrono::microseconds walLatencyBudget = std::chrono::microseconds(2000))
+        : walLatencyBudget_(walLatencyBudget) {
+        setRateLimit(IOClass::Checkpoint, 256ull << 20);
+        setRateLimit(IOClass::Compaction, 128ull << 20);
+        setRateLimit(IOClass::Backup, 64ull << 20);
+    }
+
+    // Set the byte rate of a background class (0 means unlimited)
+    void setRateLimit(IOClass ioClass, uint64_t bytesPerSecond) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Bucket& bucket = buckets_[static_cast<size_t>(ioClass)];
+        bucket.bytesPerSecond = bytesPerSecond;
+        bucket.tokens = static_cast<double>(burstBytes(bucket));
+        bucket.lastRefill = std::chrono::steady_clock::now();
+    }
+
+    // Block a background caller until `bytes` of I/O may be issued. WAL I/O is admitted immediately.
+    void acquire(IOClass ioClass, uint64_t bytes) {
+        size_t index = static_cast<size_t>(ioClass);
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex_);
+        stats_.bytes[index] += bytes;
+        if (ioClass == IOClass::WalSync) {
+            return;
+        }
+        Bucket& bucket = buckets_[index];
+        ++bucket.waiters;
+        for (;;) {
+            auto now = std::chrono::steady_clock::now();
+            refill(bucket, now);
+            bool higherWaiting = false;
+            for (size_t i = 1; i < index; ++i) {
+                higherWaiting = higherWaiting || buckets_[i].waiters > 0;
+            }
+            // Yield to in-flight WAL I/O, but only up to one latency budget so checkpoints cannot starve
+            bool foregroundClear = foregroundInFlight_ == 0 || now - start >= walLatencyBudget_;
+            if (foregroundClear && !higherWaiting && bucket.tokens > 0) {
+                break;
+            }
+            auto wait = std::chrono::microseconds(1000);
+            double rate = static_cast<double>(bucket.bytesPerSecond) * scale_;
+            if (bucket.tokens <= 0 && rate > 0) {
+                wait = std::chrono::microseconds(static_cast<int64_t>(1 - bucket.tokens * 1e6 / rate));
+            }
+            cv_.wait_for(lock, wait);
+        }
+        --bucket.waiters;
+        bucket.tokens -= static_cast<double>(bytes);  // Large requests go into debt instead of starving
+        stats_.throttledMicros[index] += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        cv_.notify_all();
+    }
+
+    // Mark the start of foreground WAL I/O; background admission pauses until it ends
+    void beginForeground() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++foregroundInFlight_;
+    }
+
+    // Mark the end of foreground WAL I/O and feed its latency into the background throttle
+    void endForeground(std::chrono::nanoseconds latency) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --foregroundInFlight_;
+            double micros = static_cast<double>(latency.count()) / 1000.0;
+            walLatencyMicros_ = walLatencyMicros_ == 0 ? micros : walLatencyMicros_ * 0.9 + micros * 0.1;
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastAdjust_ >= std::chrono::milliseconds(10)) {
+                lastAdjust_ = now;
+                if (walLatencyMicros_ > static_cast<double>(walLatencyBudget_.count())) {
+                    scale_ = std::max(scale_ / 2, kMinScale);  // Back off quickly when over budget
+                } else {
+                    scale_ = std::min(scale_ + 0.05, 1.0);     // Recover slowly when under budget
+                }
+            }
+        }
+        cv_.notify_all();
+    }
+
+    // Snapshot of the scheduler counters
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Stats stats = stats_;
+        stats.walLatencyMicros = walLatencyMicros_;
+        stats.backgroundScale = scale_;
+        return stats;
+    }
+
+private:
+    static constexpr double kMinScale = 1.0 / 64;
+
+    struct Bucket {
+        uint64_t bytesPerSecond = 0;
+        double tokens = 0;
+        std::chrono::steady_clock::time_point lastRefill = std::chrono::steady_clock::now();
+        int waiters = 0;
+    };
+
+    // Allow bursts of 100ms worth of I/O, but never less than 64KB
+    static uint64_t burstBytes(const Bucket& bucket) {
+        return std::max<uint64_t>(bucket.bytesPerSecond / 10, 64 << 10);
+    }
+
+    void refill(Bucket& bucket, std::chrono::steady_clock::time_point now) {
+        if (bucket.bytesPerSecond == 0) {
+            bucket.tokens = 1;  // Unlimited
+            return;
+        }
+        double elapsed = std::chrono::duration<double>(now - bucket.lastRefill).count();
+        bucket.lastRefill = now;
+        bucket.tokens = std::min(bucket.tokens + elapsed * static_cast<double>(bucket.bytesPerSecond) * scale_,
+                                 static_cast<double>(burstBytes(bucket)));
+    }
+
+    std::chrono::microseconds walLatencyBudget_;            // Target WAL I/O latency
+    std::array<Bucket, kClassCount> buckets_;               // Token buckets (index 0 unused)
+    int foregroundInFlight_ = 0;                            // WAL operations currently running
+    double walLatencyMicros_ = 0;                           // EWMA of WAL I/O latency
+    double scale_ = 1.0;                                    // Multiplier applied to background rates
+    std::chrono::steady_clock::time_point lastAdjust_;      // Last throttle adjustment
+    Stats stats_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// Replace fileName with the finished file tmpName so that both the new contents and the rename are
+// on disk when this returns; callers may then delete the WAL the file covers. Throws on failure.
+inline void renameDurably(const std::string& tmpName, const std::string& fileName) {
+    int fd = ::open(tmpName.c_str(), O_RDONLY | O_CLOEXEC);
+    bool synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!synced) {
+        throw std::runtime_error("Cannot sync " + tmpName);
+    }
+    std::filesystem::rename(tmpName, fileName);
+    std::string dirName = std::filesystem::path(fileName).parent_path().string();
+    fd = ::open(dirName.empty() ? "." : dirName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    synced = fd >= 0 && ::fsync(fd) == 0;
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    if (!synced) {
+        throw std::runtime_error("Cannot sync the directory of " + fileName);
+    }
+}
+
+// Sorted Snapshot Module: Read-only snapshot with records sorted by key and grouped into ~4KB blocks.
+// A learned index (piecewise-linear segments over block first keys with bounded error) predicts the
+// block of a key, so lookups touch a handful of neighbouring fence keys instead of binary searching
+// the whole block index, and only the segments (not one fence key per block) are kept in memory.
+class SortedSnapshot {
+public:
+    // Open and map an existing snapshot and load its model; valid() reports whether it was usable
+    explicit SortedSnapshot(const std::string& fileName) {
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= kHeaderSize) {
+            void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                base_ = static_cast<const char*>(addr);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+        if (base_ == nullptr) {
+            return;
+        }
+        Header header;
+        std::memcpy(&header, base_, kHeaderSize);
+        uint64_t segmentBytes = header.segmentCount * sizeof(Segment);
+        if (std::memcmp(header.magic, kMagic, 8) != 0 ||
+            header.offsetsOffset + (header.blockCount + 1) * 8 > size_ || header.segmentsOffset + segmentBytes > size_) {
+            unmap();
+            return;
+        }
+        entryCount_ = header.entryCount;
+        blockCount_ = header.blockCount;
+        maxError_ = header.maxError;
+        offsets_ = base_ + header.offsetsOffset;
+        segments_.resize(header.segmentCount);
+        if (segmentBytes > 0) {
+            std::memcpy(segments_.data(), base_ + header.segmentsOffset, segmentBytes);
+        }
+        for (const Segment& segment : segments_) {
+            segmentKeys_.emplace_back(keyAt(blockOffset(segment.firstBlock)));
+        }
+    }
+
+    ~SortedSnapshot() { unmap(); }
+
+    SortedSnapshot(const SortedSnapshot&) = delete;
+    SortedSnapshot& operator=(const SortedSnapshot&) = delete;
+
+    // Write the in-memory database as a sorted snapshot with a learned block index. With a
+    // scheduler, the file goes out in chunks admitted as checkpoint traffic.
+    static void write(const std::string& fileName, const std::unordered_map<std::string, std::string>& db,
+                      uint32_t maxError = 2, IOScheduler* scheduler = nullptr) {
+        std::vector<const std::pair<const std::string, std::string>*> sorted;
+        sorted.reserve(db.size());
+        for (const auto& pair : db) {
+            sorted.push_back(&pair);
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+        // Cut blocks and collect the first key of every block as training points
+        std::vector<uint64_t> offsets;
+        std::vector<std::string_view> fenceKeys;
+        uint64_t offset = kHeaderSize;
+        uint64_t blockStart = offset;
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            if (i == 0 || offset - blockStart >= kBlockSize) {
+                blockStart = offset;
+                offsets.push_back(offset);
+                fenceKeys.push_back(sorted[i]->first);
+            }
+            offset += 8 + sorted[i]->first.size() + sorted[i]->second.size();
+        }
+        offsets.push_back(offset);
+        std::vector<Segment> segments = fitSegments(fenceKeys, maxError);
+
+        Header header{};
+        std::memcpy(header.magic, kMagic, 8);
+        header.entryCount = sorted.size();
+        header.blockCount = fenceKeys.size();
+        header.offsetsOffset = offset;
+        header.segmentsOffset = header.offsetsOffset + offsets.size() * 8;
+        header.segmentCount = segments.size();
+        header.maxError = maxError;
+
+        std::string tmpName = fileName + ".tmp";
+        std::ofstream snapFile(tmpName, std::ios::binary | std::ios::trunc);
+        std::string chunk(reinterpret_cast<const char*>(&header), kHeaderSize);
+        auto flush = [&] {
+            if (scheduler != nullptr) {
+                scheduler->acquire(IOClass::Checkpoint, chunk.size());
+            }
+            snapFile.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            chunk.clear();
+        };
+        for (const auto* pair : sorted) {
+            uint32_t keySize = static_cast<uint32_t>(pair->first.size());
+            uint32_t valueSize = static_cast<uint32_t>(pair->second.size());
+            chunk.append(reinterpret_cast<const char*>(&keySize), 4);
+            chunk.append(reinterpret_cast<const char*>(&valueSize), 4);
+            chunk.append(pair->first).append(pair->second);
+            if (chunk.size() >= kChunkSize) {
+                flush();
+            }
+        }
+        chunk.append(reinterpret_cast<const char*>(offsets.data()), offsets.size() * 8);
+        chunk.append(reinterpret_cast<const char*>(segments.data()), segments.size() * sizeof(Segment));
+        flush();
+        snapFile.close();
+        if (!snapFile) {
+            throw std::runtime_error("Cannot write " + tmpName);
+        }
+        renameDurably(tmpName, fileName);
+    }
+
+    // Whether the snapshot was mapped and passed validation
+    [[nodiscard]] bool valid() const { return base_ != nullptr; }
+
+    // Number of key-value pairs in the snapshot
+    [[nodiscard]] uint64_t size() const { return entryCount_; }
+
+    // Bytes of in-memory index (model segments and their first keys)
+    [[nodiscard]] size_t indexMemory() const {
+        size_t bytes = segments_.size() * sizeof(Segment);
+        for (const std::string& key : segmentKeys_) {
+            bytes += sizeof(std::string) + (key.capacity() > 15 ? key.capacity() + 1 : 0);
+        }
+        return bytes;
+    }
+
+    // Number of blocks and of model segments covering them
+    [[nodiscard]] uint64_t blockCount() const { return blockCount_; }
+    [[nodiscard]] size_t segmentCount() const { return segments_.size(); }
+
+    // Retrieve the value associated with a key
+    [[nodiscard]] std::string get(const std::string& key) const {
+        if (base_ == nullptr || blockCount_ == 0) {
+            return "Key not found";
+        }
+        uint64_t block = findBlock(key);
+        uint64_t offset = blockOffset(block);
+        uint64_t end = blockOffset(block + 1);
+        while (offset < end) {
+            std::string_view recordKey = keyAt(offset);
+            uint32_t valueSize;
+            std::memcpy(&valueSize, base_ + offset + 4, 4);
+            if (recordKey == key) {
+                return std::string(base_ + offset + 8 + recordKey.size(), valueSize);
+            }
+            if (recordKey > key) {
+                break;  // Records are sorted
+            }
+            offset += 8 + recordKey.size() + valueSize;
+        }
+        return "Key not found";
+    }
+
+private:
+    static constexpr char kMagic[9] = "EXDBSST1";
+    static constexpr uint64_t kBlockSize = 4096;
+    static constexpr size_t kChunkSize = 64 << 10;   // Bytes per scheduler admission when writing
+
+    struct Header {
+        char magic[8];
+        uint64_t entryCount;
+        uint64_t blockCount;
+        uint64_t offsetsOffset;   // blockCount + 1 block start offsets
+        uint64_t segmentsOffset;  // Model segments
+        uint64_t segmentCount;
+        uint64_t maxError;        // Maximum block prediction error of the model
+    };
+    static constexpr uint64_t kHeaderSize = sizeof(Header);
+
+    // Covers blocks from firstBlock up to the next segment. Keys of the segment share their first
+    // `skip` bytes, and block = firstBlock + slope * (keyNumber(key, skip) - base).
+    struct Segment {
+        uint64_t firstBlock;
+        uint64_t skip;
+        uint64_t base;
+        double slope;
+    };
+
+    // Order-preserving 8-byte big-endian projection of the key bytes after the first `skip`
+    static uint64_t keyNumber(std::string_view key, size_t skip) {
+        uint64_t number = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            size_t pos = skip + i;
+            number = (number << 8) | (pos < key.size() ? static_cast<uint8_t>(key[pos]) : 0);
+        }
+        return number;
+    }
+
+    // Narrow the cone of slopes that keep the point (x, y) within maxError of a line through the
+    // origin; returns false once no slope is left
+    static bool narrowCone(uint64_t x, double y, uint32_t maxError, double& low, double& high) {
+        if (x == 0) {
+            return y <= maxError;
+        }
+        double dx = static_cast<double>(x);
+        low = std::max(low, (y - maxError) / dx);
+        high = std::min(high, (y + maxError) / dx);
+        return low <= high;
+    }
+
+    // Greedy shrinking-cone segmentation: extend a segment while some slope keeps every fence key
+    // within maxError blocks of its prediction. Each segment projects keys after the prefix shared
+    // by its own keys, so long common prefixes do not collapse distinct keys onto one number.
+    static std::vector<Segment> fitSegments(const std::vector<std::string_view>& fenceKeys, uint32_t maxError) {
+        std::vector<Segment> segments;
+        size_t start = 0;
+        while (start < fenceKeys.size()) {
+            std::string_view first = fenceKeys[start];
+            size_t skip = first.size();
+            double low = 0, high = std::numeric_limits<double>::infinity();
+            size_t end = start + 1;
+            for (; end < fenceKeys.size(); ++end) {
+                std::string_view key = fenceKeys[end];
+                size_t common = 0;
+                while (common < skip && common < key.size() && first[common] == key[common]) {
+                    ++common;
+                }
+                double newLow = low, newHigh = high;
+                bool fits = true;
+                if (common < skip) {
+                    // A shorter shared prefix changes every projection: refit the segment from scratch
+                    newLow = 0;
+                    newHigh = std::numeric_limits<double>::infinity();
+                    uint64_t base = keyNumber(first, common);
+                    for (size_t i = start + 1; fits && i <= end; ++i) {
+                        fits = narrowCone(keyNumber(fenceKeys[i], common) - base, static_cast<double>(i - start),
+                                          maxError, newLow, newHigh);
+                    }
+                } else {
+                    fits = narrowCone(keyNumber(key, skip) - keyNumber(first, skip), static_cast<double>(end - start),
+                                      maxError, newLow, newHigh);
+                }
+                if (!fits) {
+                    break;
+                }
+                skip = common;
+                low = newLow;
+                high = newHigh;
+            }
+            double slope = std::isinf(high) ? 0 : (low + high) / 2;
+            segments.push_back(Segment{start, skip, keyNumber(first, skip), slope});
+            start = end;
+        }
+        return segments;
+    }
+
+    uint64_t blockOffset(uint64_t block) const {
+        uint64_t offset;
+        std::memcpy(&offset, offsets_ + block * 8, 8);
+        return offset;
+    }
+
+    std::string_view keyAt(uint64_t offset) const {
+        uint32_t keySize;
+        std::memcpy(&keySize, base_ + offset, 4);
+        return std::string_view(base_ + offset + 8, keySize);
+    }
+
+    // Last block whose first key is <= key, searched in the predicted window and, if the
+    // prediction misses (only possible for keys absent from the training set), in all blocks
+    uint64_t findBlock(const std::string& key) const {
+        auto it = std::upper_bound(segmentKeys_.begin(), segmentKeys_.end(), key);
+        size_t index = it == segmentKeys_.begin() ? 0 : static_cast<size_t>(it - segmentKeys_.begin() - 1);
+        const Segment& segment = segments_[index];
+        uint64_t lastBlock = index + 1 < segments_.size() ? segments_[index + 1].firstBlock - 1 : blockCount_ - 1;
+        uint64_t x = keyNumber(key, segment.skip);
+        double predicted = static_cast<double>(segment.firstBlock) +
+                           segment.slope * static_cast<double>(x - std::min(x, segment.base));
+        // Keys past the segment's last fence key belong to its last block, not to an extrapolation;
+        // that includes keys which no longer share the segment's prefix
+        int64_t guess = std::min(static_cast<int64_t>(predicted + 0.5), static_cast<int64_t>(lastBlock));
+        if (key.compare(0, segment.skip, segmentKeys_[index], 0, segment.skip) != 0) {
+            guess = static_cast<int64_t>(lastBlock);
+        }
+        int64_t slack = static_cast<int64_t>(maxError_) + 1;
+        uint64_t low = static_cast<uint64_t>(std::clamp<int64_t>(guess - slack, 0, static_cast<int64_t>(blockCount_ - 1)));
+        uint64_t high = static_cast<uint64_t>(std::clamp<int64_t>(guess + slack, 0, static_cast<int64_t>(blockCount_ - 1)));
+        bool inWindow = (low == 0 || keyAt(blockOffset(low)) <= key) &&
+                        (high + 1 == blockCount_ || key < keyAt(blockOffset(high + 1)));
+        if (!inWindow) {
+            low = 0;
+            high = blockCount_ - 1;
+        }
+        while (low < high) {
+            uint64_t mid = (low + high + 1) / 2;
+            if (keyAt(blockOffset(mid)) <= key) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        return low;
+    }
+
+    void unmap() {
+        if (base_ != nullptr) {
+            ::munmap(const_cast<char*>(base_), size_);
+            base_ = nullptr;
+        }
+    }
+
+    const char* base_ = nullptr;     // Start of the read-only mapping
+    size_t size_ = 0;                // Length of the mapping
+    const char* offsets_ = nullptr;  // Block offsets inside the mapping
+    uint64_t entryCount_ = 0;
+    uint64_t blockCount_ = 0;
+    uint64_t maxError_ = 0;
+    std::vector<Segment> segments_;         // Learned index
+    std::vector<std::string> segmentKeys_;  // First key of each segment
+};
+
+// Field-map values: each key maps to a set of field-value pairs that can be updated individually
+using FieldMap = std::unordered_map<std::string, std::string>;
+using FieldMapTable = std::unordered_map<std::string, FieldMap>;
+
+// Content-Addressed Value Module: Stores large values once per distinct content, with reference
+// counts, and lets keys refer to them by content hash
+class BlobStore {
+public:
+    // Outcome of pointing a key at a value
+    enum class AssignResult { Shared, Created, Collision };
+
+    // Memory accounting for deduplicated values
+    struct Stats {
+        uint64_t blobs = 0;          // Distinct stored values
+        uint64_t references = 0;     // Keys referring to them
+        uint64_t storedBytes = 0;    // Bytes actually held
+        uint64_t logicalBytes = 0;   // Bytes the references would occupy without deduplication
+    };
+
+    // Content hash used as the blob identifier (FNV-1a 64, hex encoded)
+    static std::string contentHash(const std::string& value) {
+        uint64_t hash = hashKey(value);
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        return hex;
+    }
+
+    // Point a key at the blob holding value, creating the blob if needed. A hash match with
+    // different content is reported as a collision and the caller keeps the value inline.
+    AssignResult assign(const std::string& key, const std::string& value, std::string& hash) {
+        hash = contentHash(value);
+        auto it = blobs_.find(hash);
+        if (it != blobs_.end() && *it->second.value != value) {
+            release(key);
+            return AssignResult::Collision;
+        }
+        auto ref = refs_.find(key);
+        if (ref != refs_.end() && ref->second == hash) {
+            return AssignResult::Shared;  // Already refers to this content
+        }
+        AssignResult result = it == blobs_.end() ? AssignResult::Created : AssignResult::Shared;
+        if (it == blobs_.end()) {
+            it = blobs_.emplace(hash, Blob{std::make_shared<const std::string>(value), 0}).first;
+        }
+        ++it->second.refs;
+        release(key);
+        refs_[key] = hash;
+        return result;
+    }
+
+    // Register a blob by hash (used when replaying the WAL or loading a snapshot)
+    void addBlob(const std::string& hash, const std::string& value) {
+        blobs_.emplace(hash, Blob{std::make_shared<const std::string>(value), 0});
+    }
+
+    // Point a key at an already registered blob; returns false if the blob is unknown
+    bool assignExisting(const std::string& key, const std::string& hash) {
+        auto it = blobs_.find(hash);
+        if (it == blobs_.end()) {
+            return false;
+        }
+        auto ref = refs_.find(key);
+        if (ref != refs_.end() && ref->second == hash) {
+            return true;
+        }
+        ++it->second.refs;
+        release(key);
+        refs_[key] = hash;
+        return true;
+    }
+
+    // Drop the key's reference, freeing the blob with its last reference
+    void release(const std::string& key) {
+        auto ref = refs_.find(key);
+        if (ref == refs_.end()) {
+            return;
+        }
+        auto it = blobs_.find(ref->second);
+        if (--it->second.refs == 0) {
+            blobs_.erase(it);
+        }
+        refs_.erase(ref);
+    }
+
+    // Value the key refers to, or nullptr if the key has no deduplicated value
+    [[nodiscard]] const std::string* find(const std::string& key) const {
+        auto ref = refs_.find(key);
+        return ref == refs_.end() ? nullptr : blobs_.at(ref->second).value.get();
+    }
+
+    // Free blobs that ended up without references (e.g. after replaying a WAL)
+    void dropUnreferenced() {
+        for (auto it = blobs_.begin(); it != blobs_.end();) {
+            it = it->second.refs == 0 ? blobs_.erase(it) : std::next(it);
+        }
+    }
+
+    // Key -> content hash references
+    [[nodiscard]] const std::unordered_map<std::string, std::string>& refs() const { return refs_; }
+
+    // Visit every stored blob as visit(hash, value)
+    template <typename Visitor>
+    void forEachBlob(Visitor&& visit) const {
+        for (const auto& pair : blobs_) {
+            visit(pair.first, *pair.second.value);
+        }
+    }
+
+    // Memory accounting snapshot
+    [[nodiscard]] Stats stats() const {
+        Stats stats;
+        stats.blobs = blobs_.size();
+        stats.references = refs_.size();
+        for (const auto& pair : blobs_) {
+            stats.storedBytes += pair.second.value->size();
+            stats.logicalBytes += pair.second.value->size() * pair.second.refs;
+        }
+        return stats;
+    }
+
+private:
+    // Values are shared pointers so that copying the store for a checkpoint does not copy them
+    struct Blob {
+        std::shared_ptr<const std::string> value;
+        uint64_t refs;
+    };
+
+    std::unordered_map<std::string, Blob> blobs_;        // Content hash -> blob
+    std::unordered_map<std::string, std::string> refs_;  // Key -> content hash
+};
+
+// Range Tombstone Module: Hides every key in [begin, end) at once, without touching the keys.
+// Keys written after a tombstone are remembered so they stay visible; hidden keys are purged
+// lazily, either when they are written again or by the next checkpoint.
+class RangeTombstones {
+public:
+    // Smallest key above every key with the prefix (empty = unbounded)
+    static std::string prefixEnd(std::string prefix) {
+        while (!prefix.empty() && static_cast<unsigned char>(prefix.back()) == 0xff) {
+            prefix.pop_back();
+        }
+        if (!prefix.empty()) {
+            prefix.back() = static_cast<char>(static_cast<unsigned char>(prefix.back()) + 1);
+        }
+        return prefix;
+    }
+
+    static bool inRange(const std::string& key, const std::string& begin, const std::string& end) {
+        return key >= begin && (end.empty() || key < end);
+    }
+
+    // Erase every key matching pred from the value tables
+    template <typename Predicate>
+    static void purge(std::unordered_map<std::string, std::string>& db, FieldMapTable& fields, BlobStore& blobs,
+                      Predicate&& pred) {
+        for (auto it = db.begin(); it != db.end();) {
+            it = pred(it->first) ? db.erase(it) : std::next(it);
+        }
+        for (auto it = fields.begin(); it != fields.end();) {
+            it = pred(it->first) ? fields.erase(it) : std::next(it);
+        }
+        std::vector<std::string> shared;
+        for (const auto& pair : blobs.refs()) {
+            if (pred(pair.first)) {
+                shared.push_back(pair.first);
+            }
+        }
+        for (const std::string& key : shared) {
+            blobs.release(key);
+        }
+    }
+
+    [[nodiscard]] bool empty() const { return tombstones_.empty(); }
+
+    // Hide [begin, end) from now on
+    void add(const std::string& begin, const std::string& end) { tombstones_.push_back({begin, end, ++lastId_}); }
+
+    // Whether a tombstone added after the key's last write covers it
+    [[nodiscard]] bool hidden(const std::string& key) const {
+        if (tombstones_.empty()) {
+            return false;
+        }
+        auto written = writtenAfter_.find(key);
+        uint64_t since = written != writtenAfter_.end() ? written->second : 0;
+        for (auto it = tombstones_.rbegin(); it != tombstones_.rend() && it->id > since; ++it) {
+            if (inRange(key, it->begin, it->end)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Called before a write to key: returns true if its old value is hidden and must be purged
+    // first, and marks the key as written after every existing tombstone
+    bool revive(const std::string& key) {
+        if (tombstones_.empty()) {
+            return false;
+        }
+        bool wasHidden = hidden(key);
+        for (const Tombstone& tombstone : tombstones_) {
+            if (inRange(key, tombstone.begin, tombstone.end)) {
+                writtenAfter_[key] = lastId_;
+                break;
+            }
+        }
+        return wasHidden;
+    }
+
+    // Drop every tombstone once the keys they hide have been purged
+    void clear() {
+        tombstones_.clear();
+        writtenAfter_.clear();
+    }
+
+private:
+    struct Tombstone {
+        std::string begin;
+        std::string end;   // Exclusive; empty = unbounded
+        uint64_t id;       // Increases with every tombstone
+    };
+
+    std::vector<Tombstone> tombstones_;                       // Pending, oldest first
+    std::unordered_map<std::string, uint64_t> writtenAfter_;  // Key -> newest tombstone id at its last write
+    uint64_t lastId_ = 0;
+};
 
 // Storage Module: Responsible for persisting data to and loading data from disk
 class Storage {
 public:
-    // Constructor initializes the storage with the database file name
-    explicit Storage(std::string  dbFileName) : dbFileName_(std::move(dbFileName)) {}
+    // Constructor initializes the storage with the database file name, an optional I/O scheduler,
+    // and whether each save also writes a sorted snapshot with a learned index
+    explicit Storage(std::string  dbFileName, IOScheduler* scheduler = nullptr, bool sortedSnapshot = false)
+        : dbFileName_(std::move(dbFileName)), scheduler_(scheduler), sortedSnapshot_(sortedSnapshot) {}
+
+    // Name of the sorted snapshot written next to the database file
+    [[nodiscard]] std::string sortedSnapshotFileName() const { return dbFileName_ + ".sst"; }
+
+    // Memory image written on clean shutdown, and the marker that vouches for it
+    [[nodiscard]] std::string cleanImageFileName() const { return dbFileName_ + ".image"; }
+    [[nodiscard]] std::string cleanMarkerFileName() const { return dbFileName_ + ".clean"; }
+
+    // Load data from the database file into an unordered_map
+    [[nodiscard]] std::unordered_map<std::string, std::string> load() const {
+        std::unordered_map<std::string, std::string> db;
+        std::ifstream dbFile(dbFileName_);
+        std::string key, value;
+        while (dbFile >> key >> value) {
+            db[key] = value;
+        }
+        dbFile.close();
+        return db;
+    }
+
+    // Load field-map values from the field file that accompanies the database file
+    [[nodiscard]] FieldMapTable loadFieldMaps() const {
+        FieldMapTable fields;
+        std::ifstream fieldFile(fieldFileName());
+        std::string key, field, value;
+        while (fieldFile >> key >> field >> value) {
+            fields[key][field] = value;
+        }
+        fieldFile.close();
+        return fields;
+    }
+
+    // Load deduplicated values: blob contents first, then the keys that refer to them
+    [[nodiscard]] BlobStore loadBlobs() const {
+        BlobStore blobs;
+        std::ifstream blobFile(blobFileName());
+        std::string hash, value, key;
+        while (blobFile >> hash >> value) {
+            blobs.addBlob(hash, value);
+        }
+        blobFile.close();
+        std::ifstream refFile(refFileName());
+        while (refFile >> key >> hash) {
+            blobs.assignExisting(key, hash);
+        }
+        refFile.close();
+        blobs.dropUnreferenced();
+        return blobs;
+    }
+
+    // Save the in-memory database to the disk by writing to temporary files and renaming them over
+    // the database files. Writes go out in chunks admitted by the I/O scheduler as checkpoint traffic.
+    void save(const std::unordered_map<std::string, std::string>& db, const FieldMapTable& fields,
+              const BlobStore& blobs) const {
+        writeAtomically(dbFileName_, [&](std::ofstream& dbFile, std::string& chunk) {
+            for (const auto& pair : db) {
+                chunk.append(pair.first).append(" ").append(pair.second).append("\n");
+                if (chunk.size() >= kChunkSize) {
+                    writeChunk(dbFile, chunk);
+                }
+            }
+        });
+        writeAtomically(fieldFileName(), [&](std::ofstream& fieldFile, std::string& chunk) {
+            for (const auto& object : fields) {
+                for (const auto& pair : object.second) {
+                    chunk.append(object.first).append(" ").append(pair.first).append(" ").append(pair.second).append("\n");
+                    if (chunk.size() >= kChunkSize) {
+                        writeChunk(fieldFile, chunk);
+                    }
+                }
+            }
+        });
+        // Each distinct large value is written once; keys refer to it by content hash
+        writeAtomically(blobFileName(), [&](std::ofstream& blobFile, std::string& chunk) {
+            blobs.forEachBlob([&](const std::string& hash, const std::string& value) {
+                chunk.append(hash).append(" ").append(value).append("\n");
+                if (chunk.size() >= kChunkSize) {
+                    writeChunk(blobFile, chunk);
+                }
+            });
+        });
+        writeAtomically(refFileName(), [&](std::ofstream& refFile, std::string& chunk) {
+            for (const auto& pair : blobs.refs()) {
+                chunk.append(pair.first).append(" ").append(pair.second).append("\n");
+                if (chunk.size() >= kChunkSize) {
+                    writeChunk(refFile, chunk);
+                }
+            }
+        });
+        if (sortedSnapshot_) {
+            if (blobs.refs().empty()) {
+                SortedSnapshot::write(sortedSnapshotFileName(), db, 2, scheduler_);
+            } else {
+                std::unordered_map<std::string, std::string> full = db;  // The sorted snapshot stores values inline
+                for (const auto& pair : blobs.refs()) {
+                    full[pair.first] = *blobs.find(pair.first);
+                }
+                SortedSnapshot::write(sortedSnapshotFileName(), full, 2, scheduler_);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kChunkSize = 64 << 10;
+
+    // Field maps are kept next to the database file, one "key field value" line per field
+    std::string fieldFileName() const { return dbFileName_ + ".fields"; }
+
+    // Deduplicated values: "hash value" lines for blobs and "key hash" lines for references
+    std::string blobFileName() const { return dbFileName_ + ".blobs"; }
+    std::string refFileName() const { return dbFileName_ + ".refs"; }
+
+    template <typename Writer>
+    void writeAtomically(const std::string& fileName, Writer&& write) const {
+        std::string tmpName = fileName + ".tmp";
+        std::ofstream file(tmpName, std::ios_base::trunc);
+        std::string chunk;
+        write(file, chunk);
+        writeChunk(file, chunk);
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Cannot write " + tmpName);
+        }
+        renameDurably(tmpName, fileName);  // The WAL is cleared once the checkpoint is saved
+    }
+
+    void writeChunk(std::ofstream& dbFile, std::string& chunk) const {
+        if (scheduler_ != nullptr) {
+            scheduler_->acquire(IOClass::Checkpoint, chunk.size());
+        }
+        dbFile.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        dbFile.flush();
+        chunk.clear();
+    }
+
+    std::string dbFileName_;   // Name of the database file
+    IOScheduler* scheduler_;   // Optional scheduler that paces checkpoint writes
+    bool sortedSnapshot_;      // Also write a sorted snapshot on save
+};
+
+// Overwrite bytes of a value in place, zero-padding the value if the range starts past its end
+inline void overwriteRange(std::string& value, size_t offset, const std::string& bytes) {
+    if (value.size() < offset + bytes.size()) {
+        value.resize(offset + bytes.size(), '\0');
+    }
+    value.replace(offset, bytes.size(), bytes);
+}
+
+// WAL backend configuration
+struct WalOptions {
+    bool mapped = false;               // Append through a preallocated, memory-mapped log file
+    size_t segmentSize = 64 << 20;     // Bytes preallocated and mapped at a time in mapped mode
+    bool syncOnCommit = false;         // msync every record before the write returns (mapped mode)
+};
+
+// Mapped Log Module: Log file preallocated in fixed-size segments that are mapped into memory.
+// After an 8-byte magic, every record is framed as (payload length, CRC-32, payload). Appenders
+// reserve space for a frame with a fetch-add on the tail, memcpy it into the mapping and publish it
+// in reservation order; sync() flushes the published bytes with msync. open() keeps the frames up
+// to the first empty, torn or corrupt one and cuts the file there, so records past a crash-time
+// reservation hole are never replayed. close() trims the file to its records. An append that cannot
+// copy its frame (no more segments, or preallocation failed) still publishes its reservation with a
+// zero frame header, so later appenders do not wait for it forever; recovery cuts the log there, and
+// that append and every later one throw.
+class MappedLog {
+public:
+    MappedLog(std::string fileName, size_t segmentSize)
+        : fileName_(std::move(fileName)),
+          segmentSize_((std::max<size_t>(segmentSize, 1) + kPageSize - 1) / kPageSize * kPageSize),
+          segments_(kMaxSegments) {
+        open();
+    }
+
+    ~MappedLog() { close(); }
+
+    MappedLog(const MappedLog&) = delete;
+    MappedLog& operator=(const MappedLog&) = delete;
+
+    // Whether a file is in the framed format (as opposed to a plain-text log)
+    static bool isFramed(const std::string& fileName) {
+        std::ifstream file(fileName, std::ios::binary);
+        char magic[kHeaderSize] = {};
+        return file.read(magic, kHeaderSize) && std::memcmp(magic, kMagic, kHeaderSize) == 0;
+    }
+
+    // The records of a log file, framed or plain text, up to its first bad frame
+    static std::string readRecords(const std::string& fileName) {
+        std::ifstream file(fileName, std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (contents.compare(0, kHeaderSize, kMagic, kHeaderSize) != 0) {
+            contents.resize(textLength(contents.data(), contents.size()));  // Plain text, or the older format
+            return contents;
+        }
+        std::string records;
+        uint64_t end = scanFrames(contents.data(), contents.size());
+        for (uint64_t at = kHeaderSize; at < end;) {
+            uint32_t length = 0;
+            std::memcpy(&length, contents.data() + at, 4);
+            records.append(contents, static_cast<size_t>(at + kFrameHeaderSize), length);
+            at += kFrameHeaderSize + length;
+        }
+        return records;
+    }
+
+    // A record as one frame of the format
+    static std::string frame(std::string_view record) {
+        std::string framed(kFrameHeaderSize, '\0');
+        uint32_t length = static_cast<uint32_t>(record.size());
+        uint32_t crc = crc32(record.data(), record.size());
+        std::memcpy(&framed[0], &length, 4);
+        std::memcpy(&framed[4], &crc, 4);
+        framed.append(record);
+        return framed;
+    }
+
+    // Map the file (creating it if needed), find the end of its valid frames and cut the file
+    // there; the caller must not append concurrently. A plain-text log becomes one frame.
+    void open() {
+        fd_ = ::open(fileName_.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Cannot open WAL file " + fileName_);
+        }
+        struct stat st {};
+        ::fstat(fd_, &st);
+        size_t fileSize = static_cast<size_t>(st.st_size);
+        uint64_t end = kHeaderSize;
+        std::string header;
+        if (fileSize > 0) {
+            void* view = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd_, 0);
+            if (view == MAP_FAILED) {
+                throw std::runtime_error("Cannot map WAL file " + fileName_);
+            }
+            const char* data = static_cast<const char*>(view);
+            if (fileSize >= kHeaderSize && std::memcmp(data, kMagic, kHeaderSize) == 0) {
+                end = scanFrames(data, fileSize);
+            } else {
+                std::string text(data, textLength(data, fileSize));
+                header = std::string(kMagic, kHeaderSize) + (text.empty() ? std::string() : frame(text));
+            }
+            ::munmap(view, fileSize);
+        } else {
+            header.assign(kMagic, kHeaderSize);
+        }
+        if (!header.empty()) {
+            end = header.size();  // New file, or a plain-text log rewritten as a single frame
+            bool written = ::ftruncate(fd_, 0) == 0 &&
+                           ::pwrite(fd_, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size());
+            if (!written) {
+                throw std::runtime_error("Cannot write WAL file " + fileName_);
+            }
+        }
+        if (end < fileSize || !header.empty()) {
+            if (::ftruncate(fd_, static_cast<off_t>(end)) != 0) {  // Drop whatever follows the last good frame
+                throw std::runtime_error("Cannot truncate WAL file " + fileName_);
+            }
+            ::fdatasync(fd_);
+        }
+        tail_.store(end);
+        published_.store(end);
+        synced_ = end;
+        failedAt_.store(kNoFailure);  // A fresh log after rotate(); the old one ends at its failed frame
+    }
+
+    // Unmap the segments and, unless another process may still be appending, trim the
+    // preallocated space, leaving only the records
+    void close(bool trim = true) {
+        if (fd_ < 0) {
+            return;
+        }
+        for (std::atomic<char*>& segment : segments_) {
+            char* data = segment.exchange(nullptr);
+            if (data != nullptr) {
+                ::munmap(data, segmentSize_);
+            }
+        }
+        if (trim && ::ftruncate(fd_, static_cast<off_t>(published_.load())) == 0) {
+            ::fdatasync(fd_);
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    // Append a record as one frame: reserve with a fetch-add, copy, then publish once all earlier
+    // frames are. Throws if the frame cannot be copied or an earlier append failed.
+    void append(std::string_view record) {
+        if (record.empty()) {
+            return;
+        }
+        uint32_t header[2] = {static_cast<uint32_t>(record.size()), crc32(record.data(), record.size())};
+        uint64_t offset = tail_.fetch_add(kFrameHeaderSize + record.size(), std::memory_order_relaxed);
+        std::exception_ptr failure;
+        try {
+            copyTo(offset, reinterpret_cast<const char*>(header), kFrameHeaderSize);
+            copyTo(offset + kFrameHeaderSize, record.data(), record.size());
+        } catch (...) {
+            failure = std::current_exception();
+            poison(offset);
+        }
+        uint64_t end = offset + kFrameHeaderSize + record.size();
+        uint64_t expected = offset;
+        while (!published_.compare_exchange_weak(expected, end, std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed)) {
+            expected = offset;
+            std::this_thread::yield();  // An earlier reservation is still being copied
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+        if (offset > failedAt_.load(std::memory_order_relaxed)) {  // Set before the failed frame was published
+            throw std::runtime_error("WAL file " + fileName_ + " lost a record; later records are not recoverable");
+        }
+    }
+
+    // Make every published record durable
+    void sync() {
+        std::lock_guard<std::mutex> lock(syncMutex_);
+        uint64_t end = published_.load(std::memory_order_acquire);
+        for (uint64_t at = synced_ / kPageSize * kPageSize; at < end;) {
+            size_t segment = static_cast<size_t>(at / segmentSize_);
+            size_t within = static_cast<size_t>(at % segmentSize_);
+            size_t length = static_cast<size_t>(std::min<uint64_t>(end - at, segmentSize_ - within));
+            char* data = segment < kMaxSegments ? segments_[segment].load(std::memory_order_acquire) : nullptr;
+            if (data != nullptr) {  // Unmapped only behind a failed append
+                ::msync(data + within, length, MS_SYNC);
+            }
+            at += length;
+        }
+        synced_ = end;
+    }
+
+    // Bytes of published frames, without the file header
+    [[nodiscard]] uint64_t size() const { return published_.load(std::memory_order_acquire) - kHeaderSize; }
+
+private:
+    static constexpr size_t kPageSize = 4096;
+    static constexpr size_t kMaxSegments = 4096;
+    static constexpr size_t kHeaderSize = 8;
+    static constexpr size_t kFrameHeaderSize = 8;  // Payload length and CRC-32
+    static constexpr uint64_t kNoFailure = ~0ull;
+    static constexpr char kMagic[kHeaderSize + 1] = "EXDBWAL1";
+
+    // End of the last valid frame of a framed log held in memory
+    static uint64_t scanFrames(const char* data, uint64_t size) {
+        uint64_t at = kHeaderSize;
+        while (at + kFrameHeaderSize <= size) {
+            uint32_t length = 0, crc = 0;
+            std::memcpy(&length, data + at, 4);
+            std::memcpy(&crc, data + at + 4, 4);
+            if (length == 0 || length > size - at - kFrameHeaderSize ||
+                crc32(data + at + kFrameHeaderSize, length) != crc) {
+                break;  // Unused space, a reservation hole or a torn copy
+            }
+            at += kFrameHeaderSize + length;
+        }
+        return at;
+    }
+
+    // Length of a plain-text log: the older unframed mapped format leaves NUL fill after its
+    // records, while NUL bytes inside values (e.g. from setRange padding) are kept
+    static size_t textLength(const char* data, size_t size) {
+        while (size > 0 && data[size - 1] == '\0') {
+            --size;
+        }
+        return size;
+    }
+
+    // Record the failed frame at offset and zero its header, if it is mapped, so recovery stops
+    // there; called before the frame is published
+    void poison(uint64_t offset) {
+        uint64_t failedAt = failedAt_.load(std::memory_order_relaxed);
+        while (offset < failedAt && !failedAt_.compare_exchange_weak(failedAt, offset, std::memory_order_relaxed)) {
+        }
+        const char zeros[kFrameHeaderSize] = {};
+        try {
+            copyTo(offset, zeros, kFrameHeaderSize);
+        } catch (...) {
+            // Never mapped: the file holds zeros or ends there, which also stops recovery
+        }
+    }
+
+    // Copy bytes into the mapping at a log offset, across segment boundaries
+    void copyTo(uint64_t offset, const char* bytes, size_t length) {
+        uint64_t end = offset + length;
+        for (uint64_t at = offset; at < end;) {
+            size_t segment = static_cast<size_t>(at / segmentSize_);
+            size_t within = static_cast<size_t>(at % segmentSize_);
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(end - at, segmentSize_ - within));
+            if (segment >= kMaxSegments) {
+                throw std::runtime_error("WAL file " + fileName_ + " is full");
+            }
+            char* data = segments_[segment].load(std::memory_order_acquire);
+            if (data == nullptr) {
+                data = mapSegment(segment);
+            }
+            std::memcpy(data + within, bytes + (at - offset), chunk);
+            at += chunk;
+        }
+    }
+
+    // Preallocate and map one segment; concurrent appenders that need it wait for the first
+    char* mapSegment(size_t segment) {
+        std::lock_guard<std::mutex> lock(growMutex_);
+        char* data = segments_.at(segment).load(std::memory_order_acquire);
+        if (data != nullptr) {
+            return data;
+        }
+        off_t offset = static_cast<off_t>(segment * segmentSize_);
+        struct stat st {};
+        ::fstat(fd_, &st);
+        if (st.st_size < offset + static_cast<off_t>(segmentSize_)) {
+            if (::posix_fallocate(fd_, offset, static_cast<off_t>(segmentSize_)) != 0 &&
+                ::ftruncate(fd_, offset + static_cast<off_t>(segmentSize_)) != 0) {
+                throw std::runtime_error("Cannot preallocate WAL segment in " + fileName_);
+            }
+            ::fdatasync(fd_);  // Make the new file size durable before records land in it
+        }
+        void* mapped = ::mmap(nullptr, segmentSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, offset);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Cannot map WAL segment in " + fileName_);
+        }
+        data = static_cast<char*>(mapped);
+        segments_[segment].store(data, std::memory_order_release);
+        return data;
+    }
+
+    std::string fileName_;
+    size_t segmentSize_;                       // Multiple of the page size
+    int fd_ = -1;
+    std::vector<std::atomic<char*>> segments_; // Mapping of each segment, created on demand
+    std::atomic<uint64_t> tail_{0};            // End of reserved space
+    std::atomic<uint64_t> published_{0};       // End of fully copied records
+    std::atomic<uint64_t> failedAt_{kNoFailure}; // Offset of the first frame that could not be copied
+    uint64_t synced_ = 0;                      // End of durable records
+    std::mutex growMutex_;                     // Serializes preallocation and mapping
+    std::mutex syncMutex_;                     // Serializes msync calls
+};
+
+// Unix Socket Utility: Connects, listens and moves whole buffers over Unix domain stream sockets
+class UnixSocket {
+public:
+    // Connect to a listening socket; returns the descriptor, or -1
+    static int connectTo(const std::string& socketPath) {
+        sockaddr_un address{};
+        if (!makeAddress(socketPath, address)) {
+            return -1;
+        }
+        int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sock >= 0 && ::connect(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(sock);
+            return -1;
+        }
+        return sock;
+    }
+
+    // Listen on socketPath, replacing a stale socket file; returns the descriptor, or -1
+    static int listenOn(const std::string& socketPath) {
+        sockaddr_un address{};
+        if (!makeAddress(socketPath, address)) {
+            return -1;
+        }
+        int sock = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sock < 0) {
+            return -1;
+        }
+        ::unlink(socketPath.c_str());
+        if (::bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(sock, 4) != 0) {
+            ::close(sock);
+            return -1;
+        }
+        return sock;
+    }
+
+    // Send exactly size bytes; false if the peer went away
+    static bool writeAll(int sock, const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t written = ::send(sock, bytes, size, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    // Receive exactly size bytes; false if the peer went away
+    static bool readAll(int sock, void* data, size_t size) {
+        char* bytes = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t received = ::recv(sock, bytes, size, 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return false;
+            }
+            bytes += received;
+            size -= static_cast<size_t>(received);
+        }
+        return true;
+    }
+
+private:
+    static bool makeAddress(const std::string& socketPath, sockaddr_un& address) {
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        return true;
+    }
+};
+
+// NUMA Topology Module: Discovers NUMA nodes and their CPUs from sysfs, pins threads to a node and
+// binds memory ranges to a node. Uses the mbind system call directly, so libnuma is not required.
+// Machines without NUMA information are treated as a single node holding every CPU. Nodes are
+// numbered densely from 0 in the order of the kernel's online node ids, which may have gaps.
+class NumaTopology {
+public:
+    // Topology of this machine, read once
+    static const NumaTopology& instance() {
+        static const NumaTopology topology;
+        return topology;
+    }
+
+    [[nodiscard]] int nodeCount() const { return static_cast<int>(cpus_.size()); }
+
+    // Kernel node id of a node
+    [[nodiscard]] int kernelNodeId(int node) const { return nodeIds_.at(static_cast<size_t>(node)); }
+
+    // CPUs that belong to a node
+    [[nodiscard]] const std::vector<int>& cpusOf(int node) const { return cpus_.at(static_cast<size_t>(node)); }
+
+    // Node that a CPU belongs to (0 if unknown)
+    [[nodiscard]] int nodeOfCpu(int cpu) const {
+        return cpu >= 0 && static_cast<size_t>(cpu) < cpuNodes_.size() ? cpuNodes_[static_cast<size_t>(cpu)] : 0;
+    }
+
+    // Node of the CPU the calling thread is running on
+    [[nodiscard]] int currentNode() const { return nodeOfCpu(sched_getcpu()); }
+
+    // Restrict the calling thread to the CPUs of a node
+    bool pinCurrentThread(int node) const {
+        if (node < 0 || node >= nodeCount()) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpusOf(node)) {
+            CPU_SET(cpu, &set);
+        }
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+
+    // Place the pages of a page-aligned range on a node, moving pages that are already populated
+    bool bindMemory(void* address, size_t length, int node) const {
+        if (node < 0 || node >= nodeCount() || length == 0) {
+            return false;
+        }
+        constexpr int kMpolBind = 2;      // MPOL_BIND
+        constexpr unsigned kMpolMove = 2; // MPOL_MF_MOVE
+        int id = kernelNodeId(node);
+        std::vector<unsigned long> mask(static_cast<size_t>(id) / 64 + 1, 0);
+        mask[static_cast<size_t>(id) / 64] = 1ul << (id % 64);
+        return syscall(SYS_mbind, address, length, kMpolBind, mask.data(), mask.size() * 64 + 1, kMpolMove) == 0;
+    }
+
+private:
+    NumaTopology() {
+        const std::filesystem::path root = "/sys/devices/system/node";
+        std::ifstream onlineFile(root / "online");
+        std::string online;
+        std::getline(onlineFile, online);
+        for (int id : parseCpuList(online)) {  // Same list format as CPU lists, e.g. "0,2-3"
+            std::ifstream listFile(root / ("node" + std::to_string(id)) / "cpulist");
+            std::string list;
+            std::getline(listFile, list);
+            nodeIds_.push_back(id);
+            cpus_.push_back(parseCpuList(list));
+        }
+        if (cpus_.empty()) {
+            nodeIds_.push_back(0);
+            std::vector<int> all(std::max(1u, std::thread::hardware_concurrency()));
+            for (size_t cpu = 0; cpu < all.size(); ++cpu) {
+                all[cpu] = static_cast<int>(cpu);
+            }
+            cpus_.push_back(all);
+        }
+        for (size_t node = 0; node < cpus_.size(); ++node) {
+            for (int cpu : cpus_[node]) {
+                if (static_cast<size_t>(cpu) >= cpuNodes_.size()) {
+                    cpuNodes_.resize(static_cast<size_t>(cpu) + 1, 0);
+                }
+                cpuNodes_[static_cast<size_t>(cpu)] = static_cast<int>(node);
+            }
+        }
+    }
+
+    // Parse a sysfs CPU list such as "0-3,8-11"
+    static std::vector<int> parseCpuList(const std::string& list) {
+        std::vector<int> cpus;
+        size_t pos = 0;
+        while (pos < list.size() && std::isdigit(static_cast<unsigned char>(list[pos]))) {
+            size_t end = 0;
+            int first = std::stoi(list.substr(pos), &end);
+            pos += end;
+            int last = first;
+            if (pos < list.size() && list[pos] == '-') {
+                last = std::stoi(list.substr(pos + 1), &end);
+                pos += end + 1;
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+            if (pos < list.size() && list[pos] == ',') {
+                ++pos;
+            }
+        }
+        return cpus;
+    }
+
+    std::vector<int> nodeIds_;             // Node -> kernel node id
+    std::vector<std::vector<int>> cpus_;   // Node -> CPUs
+    std::vector<int> cpuNodes_;            // CPU -> node
+};
+
+// Replication configuration: a leader lists its followers, a follower names the socket it listens on
+struct ReplicationOptions {
+    std::vector<std::string> followers;          // Socket paths of the followers to ship the WAL to
+    size_t ackQuorum = 0;                        // Followers that must have a write durably before it returns
+    std::chrono::milliseconds ackTimeout{5000};  // After this long, a write returns without its quorum and
+                                                 // writes stop waiting until a quorum catches up
+    size_t backlogBytes = 64 << 20;              // Records kept for followers that fall behind or reconnect
+    std::string listenSocket;                    // Follow a leader that connects on this socket
+};
+
+// Replication progress of a leader (records shipped) or a follower (records applied)
+struct ReplicationStats {
+    uint64_t lastLsn = 0;           // Last record shipped (leader) or durably applied (follower)
+    uint64_t batches = 0;           // Batches sent to all followers (leader) or applied (follower)
+    uint64_t quorumTimeouts = 0;    // Writes that returned without their ack quorum
+    bool degraded = false;          // Writes skip the ack wait until a quorum catches up after a timeout
+    size_t connectedFollowers = 0;  // Followers currently connected
+    size_t lostFollowers = 0;       // Followers that missed records no longer in the backlog, if no
+                                    // copy of the data can be sent instead
+    uint64_t reseeds = 0;           // Copies of the data sent to followers new to the session or lost
+};
+
+// Replication Leader Module: Semi-synchronous WAL shipping. Every WAL record gets a log sequence
+// number (LSN) and is streamed to each follower by its own sender thread. A sender sends whatever
+// has accumulated as one batch and does not wait for the acknowledgement before sending the next,
+// so concurrent writers share one round trip per batch. Followers acknowledge the last LSN they
+// have durably appended; awaitQuorum blocks a writer until ackQuorum of them reached its record.
+// After a wait times out, writes return without waiting (asynchronous replication) until ackQuorum
+// followers have caught up with the record that timed out.
+// Records stay in a bounded backlog until every follower acknowledged them, so a follower that
+// reconnects resumes where it stopped. With a snapshot function, a follower new to this session
+// (a new follower, or any follower after a leader restart) first gets a copy of the data, which
+// replaces its own, and so does a follower that needs records already dropped from the backlog.
+class ReplicationLeader {
+public:
+    // Writes the data as records and returns the LSN of the last record they include; it must
+    // keep ship() from running meanwhile, and is called without the leader's lock held
+    using SnapshotFunction = std::function<uint64_t(std::string& records)>;
+
+    // Sender and acknowledgement threads are pinned to numaNode's CPUs when it is not -1
+    explicit ReplicationLeader(const ReplicationOptions& options, SnapshotFunction snapshot = nullptr,
+                               int numaNode = -1)
+        : snapshot_(std::move(snapshot)), numaNode_(numaNode),
+          quorum_(std::min(options.ackQuorum, options.followers.size())),
+          ackTimeout_(options.ackTimeout),
+          backlogBytes_(options.backlogBytes),
+          session_((static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}()) {
+        for (const std::string& socketPath : options.followers) {
+            followers_.push_back(std::make_unique<Follower>(socketPath));
+        }
+        for (auto& follower : followers_) {
+            follower->sender = std::thread([this, target = follower.get()] { run(*target); });
+        }
+    }
+
+    ~ReplicationLeader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            for (auto& follower : followers_) {
+                if (follower->sock >= 0) {
+                    ::shutdown(follower->sock, SHUT_RDWR);
+                }
+            }
+        }
+        shipped_.notify_all();
+        acked_.notify_all();
+        for (auto& follower : followers_) {
+            follower->sender.join();
+        }
+    }
+
+    ReplicationLeader(const ReplicationLeader&) = delete;
+    ReplicationLeader& operator=(const ReplicationLeader&) = delete;
+
+    // Number a record and queue it for every follower; called in WAL order
+    uint64_t ship(const std::string& record) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        backlog_.push_back(record);
+        backlogSize_ += record.size();
+        lastShipped_ = ++lastLsn_;
+        trimBacklog();
+        shipped_.notify_all();
+        return lastLsn_;
+    }
+
+    // LSN of the last record this thread shipped (0 if none)
+    static uint64_t lastShippedByThisThread() { return lastShipped_; }
+
+    // Read-your-writes token of a record: its LSN, tagged with the top bits of the session so that
+    // a follower never takes a token of one leader run for an LSN of another
+    uint64_t tokenFor(uint64_t lsn) const { return (session_ & kSessionTagMask) | lsn; }
+
+    // Whether a follower that applied up to the LSN applied in a session has the write of a token
+    static bool tokenApplied(uint64_t session, uint64_t applied, uint64_t token) {
+        uint64_t lsn = token & ~kSessionTagMask;
+        return lsn == 0 || ((token & kSessionTagMask) == (session & kSessionTagMask) && applied >= lsn);
+    }
+
+    // LSN of the last record shipped by any thread
+    uint64_t lastLsn() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lastLsn_;
+    }
+
+    // Wait until ackQuorum followers have durably appended the record with this LSN; false if the
+    // timeout passed first, or if an earlier timeout has not been caught up with yet (the record
+    // stays queued for the followers either way)
+    bool awaitQuorum(uint64_t lsn) {
+        if (quorum_ == 0) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        bool reached = ackCount(lsn) >= quorum_ ||
+                       (catchUpLsn_ == 0 &&
+                        acked_.wait_for(lock, ackTimeout_, [&] { return stopping_ || ackCount(lsn) >= quorum_; }));
+        if (!reached) {
+            ++quorumTimeouts_;
+            if (catchUpLsn_ == 0) {
+                catchUpLsn_ = lsn;  // Stop waiting until a quorum has this record
+            }
+        }
+        return reached;
+    }
+
+    ReplicationStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ReplicationStats stats;
+        stats.lastLsn = lastLsn_;
+        stats.batches = batches_;
+        stats.quorumTimeouts = quorumTimeouts_;
+        stats.degraded = catchUpLsn_ != 0;
+        stats.reseeds = reseeds_;
+        for (const auto& follower : followers_) {
+            stats.connectedFollowers += follower->sock >= 0 ? 1 : 0;
+            stats.lostFollowers += follower->lost ? 1 : 0;
+        }
+        return stats;
+    }
+
+private:
+    struct Follower {
+        explicit Follower(std::string path) : socketPath(std::move(path)) {}
+        std::string socketPath;
+        int sock = -1;          // Connection, -1 while disconnected
+        bool broken = false;    // The connection failed; the sender reconnects
+        bool lost = false;      // Missed records no longer in the backlog; needs a fresh copy of the data
+        bool fresh = false;     // New to this session; gets a copy of the data before any records
+        uint64_t sent = 0;      // Last LSN sent on the connection
+        uint64_t acked = 0;     // Last LSN the follower durably appended
+        std::thread sender;
+    };
+
+    static constexpr auto kReconnectInterval = std::chrono::milliseconds(100);
+    static constexpr uint64_t kSessionTagMask = 0xffffull << 48;  // Token bits above the LSN
+
+    // Sender thread of one follower: connect, then send batches until stopped or disconnected
+    void run(Follower& follower) {
+        NumaTopology::instance().pinCurrentThread(numaNode_);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_ && !follower.lost) {
+            lock.unlock();
+            int sock = UnixSocket::connectTo(follower.socketPath);
+            uint64_t last = 0;  // The follower's last LSN in this session, 0 if it is new to it
+            bool greeted = sock >= 0 && UnixSocket::writeAll(sock, &session_, sizeof(session_)) &&
+                           UnixSocket::readAll(sock, &last, sizeof(last));
+            lock.lock();
+            if (!greeted || stopping_) {
+                if (sock >= 0) {
+                    ::close(sock);
+                }
+                shipped_.wait_for(lock, kReconnectInterval, [&] { return stopping_; });
+                continue;
+            }
+            follower.sock = sock;
+            follower.broken = false;
+            follower.sent = last;
+            follower.acked = last;
+            follower.fresh = last == 0 && snapshot_ != nullptr;
+            lock.unlock();
+            std::thread reader([this, &follower, sock] { readAcks(follower, sock); });
+            lock.lock();
+            sendBatches(follower, sock, lock);
+            ::shutdown(sock, SHUT_RDWR);
+            lock.unlock();
+            reader.join();
+            lock.lock();
+            ::close(sock);
+            follower.sock = -1;
+        }
+    }
+
+    // Send everything shipped since the last batch as one batch, without waiting for acknowledgements
+    void sendBatches(Follower& follower, int sock, std::unique_lock<std::mutex>& lock) {
+        while (true) {
+            shipped_.wait(lock, [&] {
+                return stopping_ || follower.broken || follower.fresh || lastLsn_ > follower.sent;
+            });
+            if (stopping_ || follower.broken) {
+                return;
+            }
+            if (follower.fresh || follower.sent + 1 < backlogFirst_) {
+                if (!snapshot_) {
+                    follower.lost = true;  // The records it needs were dropped from the backlog
+                    trimBacklog();
+                    return;
+                }
+                if (!sendSnapshot(follower, sock, lock)) {
+                    return;
+                }
+                continue;
+            }
+            uint64_t header[3] = {follower.sent + 1, lastLsn_, 0};  // First LSN, last LSN, payload bytes
+            std::string payload;
+            for (uint64_t lsn = header[0]; lsn <= header[1]; ++lsn) {
+                payload += backlog_[lsn - backlogFirst_];
+            }
+            header[2] = payload.size();
+            follower.sent = header[1];
+            ++batches_;
+            lock.unlock();
+            bool sent = UnixSocket::writeAll(sock, header, sizeof(header)) &&
+                        UnixSocket::writeAll(sock, payload.data(), payload.size());
+            lock.lock();
+            if (!sent) {
+                return;
+            }
+        }
+    }
+
+    // Send a copy of the data in place of the records the follower missed or never had: a batch with
+    // first LSN 0
+    bool sendSnapshot(Follower& follower, int sock, std::unique_lock<std::mutex>& lock) {
+        lock.unlock();
+        std::string records;
+        uint64_t header[3] = {0, snapshot_(records), records.size()};  // Takes the database's lock
+        bool sent = UnixSocket::writeAll(sock, header, sizeof(header)) &&
+                    UnixSocket::writeAll(sock, records.data(), records.size());
+        lock.lock();
+        if (sent) {
+            follower.sent = header[1];
+            follower.fresh = false;
+            ++reseeds_;
+        }
+        return sent;
+    }
+
+    // Reader thread of one connection: record acknowledgements and wake the waiting writers
+    void readAcks(Follower& follower, int sock) {
+        NumaTopology::instance().pinCurrentThread(numaNode_);
+        uint64_t acked = 0;
+        while (UnixSocket::readAll(sock, &acked, sizeof(acked))) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            follower.acked = std::max(follower.acked, acked);
+            if (catchUpLsn_ != 0 && ackCount(catchUpLsn_) >= quorum_) {
+                catchUpLsn_ = 0;  // The quorum caught up; writes wait for it again
+            }
+            trimBacklog();
+            acked_.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        follower.broken = true;
+        shipped_.notify_all();
+    }
+
+    size_t ackCount(uint64_t lsn) const {
+        size_t count = 0;
+        for (const auto& follower : followers_) {
+            count += follower->acked >= lsn ? 1 : 0;
+        }
+        return count;
+    }
+
+    // Drop records every follower has, and the oldest records while the backlog is over its limit
+    void trimBacklog() {
+        uint64_t needed = lastLsn_ + 1;
+        for (const auto& follower : followers_) {
+            if (!follower->lost) {
+                needed = std::min(needed, follower->acked + 1);
+            }
+        }
+        while (!backlog_.empty() && (backlogFirst_ < needed || backlogSize_ > backlogBytes_)) {
+            backlogSize_ -= backlog_.front().size();
+            backlog_.pop_front();
+            ++backlogFirst_;
+        }
+    }
+
+    SnapshotFunction snapshot_;                // Copy of the data for lost followers, if set
+    int numaNode_;                             // Node whose CPUs run the threads, -1 for any
+    size_t quorum_;
+    std::chrono::milliseconds ackTimeout_;
+    size_t backlogBytes_;
+    uint64_t session_;                         // Identifies this leader run to the followers
+    std::vector<std::unique_ptr<Follower>> followers_;
+    std::deque<std::string> backlog_;          // Records from LSN backlogFirst_ to lastLsn_
+    uint64_t backlogFirst_ = 1;
+    size_t backlogSize_ = 0;
+    uint64_t lastLsn_ = 0;
+    uint64_t batches_ = 0;
+    uint64_t quorumTimeouts_ = 0;
+    uint64_t catchUpLsn_ = 0;                  // Record that timed out, while writes skip the wait; else 0
+    uint64_t reseeds_ = 0;
+    bool stopping_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable shipped_;          // New records, a broken connection or shutdown
+    std::condition_variable acked_;            // New acknowledgements
+    static inline thread_local uint64_t lastShipped_ = 0;
+};
+
+// Replication Follower Module: Accepts a leader's connection on a Unix socket and hands its record
+// batches to an apply function, which must append them durably before returning. Batches that
+// arrive together are applied (and synced) together and acknowledged with their last LSN. A leader
+// with a new session starts again from LSN 1. A copy of the leader's data replaces the local data
+// through the restore function. The session and the last applied LSN are kept in a state file, so
+// a restarted follower resumes where it stopped; a crash between an apply and the state update
+// applies a few records twice, which leaves the same data since every record sets its target.
+class ReplicationFollower {
+public:
+    using ApplyFunction = std::function<void(uint64_t lastLsn, const std::string& records)>;
+    using SessionFunction = std::function<void(uint64_t session)>;  // A new leader run; nothing applied in it yet
+
+    // The receiving thread is pinned to numaNode's CPUs when it is not -1
+    ReplicationFollower(const std::string& socketPath, const std::string& stateFileName, ApplyFunction apply,
+                        ApplyFunction restore, SessionFunction newSession, int numaNode = -1)
+        : apply_(std::move(apply)), restore_(std::move(restore)), newSession_(std::move(newSession)),
+          numaNode_(numaNode) {
+        stateFd_ = ::open(stateFileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (stateFd_ < 0) {
+            throw std::runtime_error("Cannot open replication state file " + stateFileName);
+        }
+        uint64_t state[3] = {};  // Session, applied LSN, CRC-32 of both
+        if (::pread(stateFd_, state, sizeof(state), 0) == static_cast<ssize_t>(sizeof(state)) &&
+            crc32(reinterpret_cast<const char*>(state), 2 * sizeof(uint64_t)) == state[2]) {
+            session_ = state[0];
+            applied_ = state[1];
+        }
+        listener_ = UnixSocket::listenOn(socketPath);
+        if (listener_ < 0) {
+            throw std::runtime_error("Cannot listen for a replication leader on " + socketPath);
+        }
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~ReplicationFollower() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            if (sock_ >= 0) {
+                ::shutdown(sock_, SHUT_RDWR);
+            }
+        }
+        thread_.join();
+        ::close(listener_);
+        ::close(stateFd_);
+    }
+
+    ReplicationFollower(const ReplicationFollower&) = delete;
+    ReplicationFollower& operator=(const ReplicationFollower&) = delete;
+
+    // Session of the current leader run and the last LSN applied in it
+    std::pair<uint64_t, uint64_t> position() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return {session_, applied_};
+    }
+
+    ReplicationStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ReplicationStats stats;
+        stats.lastLsn = applied_;
+        stats.batches = batches_;
+        stats.connectedFollowers = sock_ >= 0 ? 1 : 0;
+        return stats;
+    }
+
+private:
+    static constexpr size_t kMaxBatchBytes = 4 << 20;  // Apply at least this often while records keep arriving
+
+    void run() {
+        NumaTopology::instance().pinCurrentThread(numaNode_);
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) {
+                    return;
+                }
+            }
+            pollfd waiting{listener_, POLLIN, 0};
+            if (::poll(&waiting, 1, 100) != 1) {
+                continue;
+            }
+            int sock = ::accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (sock < 0) {
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) {
+                    ::close(sock);
+                    return;
+                }
+                sock_ = sock;
+            }
+            serve(sock);
+            std::lock_guard<std::mutex> lock(mutex_);
+            sock_ = -1;
+            ::close(sock);
+        }
+    }
+
+    // Greet the leader with our last LSN in its session, then apply and acknowledge its batches
+    void serve(int sock) {
+        uint64_t session = 0;
+        if (!UnixSocket::readAll(sock, &session, sizeof(session))) {
+            return;
+        }
+        uint64_t applied = 0;
+        bool newSession = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            newSession = session != session_;
+            if (newSession) {
+                session_ = session;
+                applied_ = 0;
+            }
+            applied = applied_;
+        }
+        if (newSession) {
+            saveState(session, 0);
+            newSession_(session);
+        }
+        if (!UnixSocket::writeAll(sock, &applied, sizeof(applied))) {
+            return;
+        }
+        std::string records;
+        uint64_t last = applied;
+        bool connected = true;
+        while (connected) {
+            uint64_t header[3] = {};  // First LSN (0 for a copy of the data), last LSN, payload bytes
+            connected = UnixSocket::readAll(sock, header, sizeof(header)) &&
+                        (header[0] == last + 1 || header[0] == 0) && header[1] >= header[0];
+            if (connected && header[0] == 0) {
+                std::string copy(header[2], '\0');
+                connected = UnixSocket::readAll(sock, copy.data(), copy.size());
+                if (connected) {
+                    records.clear();  // Included in the copy
+                    last = header[1];
+                    restore_(last, copy);
+                    recordApplied(session, last);
+                }
+                connected = connected && UnixSocket::writeAll(sock, &last, sizeof(last));
+                continue;
+            }
+            if (connected) {
+                size_t offset = records.size();
+                records.resize(offset + header[2]);
+                connected = UnixSocket::readAll(sock, records.data() + offset, header[2]);
+                last = connected ? header[1] : last;
+                records.resize(connected ? records.size() : offset);
+            }
+            pollfd more{sock, POLLIN, 0};
+            if (connected && records.size() < kMaxBatchBytes && ::poll(&more, 1, 0) == 1) {
+                continue;  // Apply everything that has already arrived with one sync
+            }
+            if (!records.empty()) {
+                apply_(last, records);
+                records.clear();
+                recordApplied(session, last);
+            }
+            connected = connected && UnixSocket::writeAll(sock, &last, sizeof(last));
+        }
+    }
+
+    // Record a durably applied batch, in memory and in the state file
+    void recordApplied(uint64_t session, uint64_t last) {
+        saveState(session, last);
+        std::lock_guard<std::mutex> lock(mutex_);
+        applied_ = last;
+        ++batches_;
+    }
+
+    void saveState(uint64_t session, uint64_t applied) {
+        uint64_t state[3] = {session, applied, 0};
+        state[2] = crc32(reinterpret_cast<const char*>(state), 2 * sizeof(uint64_t));
+        if (::pwrite(stateFd_, state, sizeof(state), 0) == static_cast<ssize_t>(sizeof(state))) {
+            ::fdatasync(stateFd_);
+        }
+    }
+
+    ApplyFunction apply_;
+    ApplyFunction restore_;
+    SessionFunction newSession_;
+    int numaNode_;              // Node whose CPUs run the thread, -1 for any
+    int stateFd_ = -1;          // Session and applied LSN that survive a restart
+    int listener_ = -1;
+    int sock_ = -1;             // Current leader connection
+    uint64_t session_ = 0;      // Session of the leader the applied LSN belongs to
+    uint64_t applied_ = 0;      // Last LSN durably applied
+    uint64_t batches_ = 0;
+    bool stopping_ = false;
+    mutable std::mutex mutex_;
+    std::thread thread_;
+};
+
+// Write-Ahead Logging (WAL) Module: Manages logging of operations for durability and recovery
+class WAL {
+public:
+    // Constructor initializes the WAL with the log file name, an optional I/O scheduler and the
+    // backend options
+    explicit WAL(std::string  walFileName, IOScheduler* scheduler = nullptr, const WalOptions& options = {})
+        : walFileName_(std::move(walFileName)), scheduler_(scheduler), syncOnCommit_(options.syncOnCommit) {
+        std::error_code ec;
+        if (options.mapped) {
+            mappedLog_ = std::make_unique<MappedLog>(walFileName_, options.segmentSize);
+        } else if (MappedLog::isFramed(walFileName_)) {
+            std::string records = MappedLog::readRecords(walFileName_);  // Left by a mapped WAL
+            std::ofstream plain(walFileName_, std::ios::binary | std::ios::trunc);
+            plain << records;
+        }
+        uint64_t current = mappedLog_ ? mappedLog_->size() : std::filesystem::file_size(walFileName_, ec);
+        currentBytes_ = ec ? 0 : current;
+        uint64_t rotated = std::filesystem::file_size(rotatedFileName(), ec);
+        rotatedBytes_ = ec ? 0 : rotated;
+    }
+
+    // Log a write (PUT) operation to the WAL
+    void logWriteOperation(const std::string& key, const std::string& value) const {
+        append(writeRecord(key, value));
+    }
+
+    // Log a delete (DEL) operation to the WAL
+    void logDeleteOperation(const std::string& key) const {
+        append(deleteRecord(key));
+    }
+
+    // Log the content of a new deduplicated value (BLOB), once per blob
+    void logBlobOperation(const std::string& hash, const std::string& value) const {
+        append(blobRecord(hash, value));
+    }
+
+    // Log a write that refers to a deduplicated value by its content hash (PUTREF)
+    void logReferenceOperation(const std::string& key, const std::string& hash) const {
+        append(referenceRecord(key, hash));
+    }
+
+    // Log the deletion of every key in [begin, end) as a single range tombstone (DELRANGE)
+    void logRangeDeleteOperation(const std::string& begin, const std::string& end) const {
+        append(rangeDeleteRecord(begin, end));
+    }
+
+    // Log the deletion of every key with a prefix as a single range tombstone (DELPREFIX)
+    void logPrefixDeleteOperation(const std::string& prefix) const { append(prefixDeleteRecord(prefix)); }
+
+    // Log several records with a single append, shipped to followers as one batch
+    void logBatch(const std::string& records) const { append(records); }
+
+    // Log a field update (HSET) of a field-map value; only the changed field is recorded
+    void logFieldWriteOperation(const std::string& key, const std::string& field, const std::string& value) const {
+        append(fieldWriteRecord(key, field, value));
+    }
+
+    // Log a field delete (HDEL) of a field-map value
+    void logFieldDeleteOperation(const std::string& key, const std::string& field) const {
+        append(fieldDeleteRecord(key, field));
+    }
+
+    // Log a partial overwrite (SETRANGE) operation; only the modified bytes are recorded
+    void logRangeOperation(const std::string& key, size_t offset, const std::string& bytes) const {
+        append(rangeRecord(key, offset, bytes));
+    }
+
+    // Records as they appear in the log, also replicated as Raft entries
+    static std::string writeRecord(const std::string& key, const std::string& value) {
+        return "PUT " + key + " " + value + "\n";
+    }
+
+    static std::string deleteRecord(const std::string& key) { return "DEL " + key + "\n"; }
+
+    static std::string rangeDeleteRecord(const std::string& begin, const std::string& end) {
+        return "DELRANGE " + begin + " " + end + "\n";
+    }
+
+    static std::string prefixDeleteRecord(const std::string& prefix) { return "DELPREFIX " + prefix + "\n"; }
+
+    static std::string fieldWriteRecord(const std::string& key, const std::string& field, const std::string& value) {
+        return "HSET " + key + " " + field + " " + value + "\n";
+    }
+
+    static std::string fieldDeleteRecord(const std::string& key, const std::string& field) {
+        return "HDEL " + key + " " + field + "\n";
+    }
+
+    static std::string rangeRecord(const std::string& key, size_t offset, const std::string& bytes) {
+        return "SETRANGE " + key + " " + std::to_string(offset) + " " + bytes + "\n";
+    }
+
+    static std::string blobRecord(const std::string& hash, const std::string& value) {
+        return "BLOB " + hash + " " + value + "\n";
+    }
+
+    static std::string referenceRecord(const std::string& key, const std::string& hash) {
+        return "PUTREF " + key + " " + hash + "\n";
+    }
+
+    // Apply the operations recorded in the WAL (rotated segment first) to the in-memory database
+    void applyLog(std::unordered_map<std::string, std::string>& db, FieldMapTable& fields, BlobStore& blobs) const {
+        for (const std::string& fileName : {rotatedFileName(), walFileName_}) {
+            if (MappedLog::isFramed(fileName)) {
+                std::istringstream records(MappedLog::readRecords(fileName));
+                applyRecords(records, db, fields, blobs);
+                continue;
+            }
+            std::ifstream walFile(fileName);
+            applyRecords(walFile, db, fields, blobs);
+            walFile.close();
+        }
+        blobs.dropUnreferenced();
+    }
+
+    // Apply the records read from a stream, such as a log file or a batch shipped by a leader
+    static void applyRecords(std::istream& walFile, std::unordered_map<std::string, std::string>& db,
+                             FieldMapTable& fields, BlobStore& blobs) {
+        std::string operation, key, field, value;
+        // A mapped WAL of the older, unframed format ends at its first NUL byte
+        while (walFile >> std::ws && walFile.peek() != '\0' && walFile >> operation >> key) {
+            if (operation == "PUT") {
+                walFile >> value;
+                db[key] = value;
+                fields.erase(key);
+                blobs.release(key);
+            } else if (operation == "DEL") {
+                db.erase(key);
+                fields.erase(key);
+                blobs.release(key);
+            } else if (operation == "SETRANGE") {
+                size_t offset = 0;
+                walFile >> offset >> value;
+                if (const std::string* shared = blobs.find(key)) {
+                    db[key] = *shared;  // Copy on write
+                    blobs.release(key);
+                }
+                overwriteRange(db[key], offset, value);
+                fields.erase(key);
+            } else if (operation == "DELRANGE" || operation == "DELPREFIX") {
+                std::string end = RangeTombstones::prefixEnd(key);  // The second token is the range start
+                if (operation == "DELRANGE") {
+                    walFile >> end;
+                }
+                RangeTombstones::purge(db, fields, blobs, [&](const std::string& candidate) {
+                    return RangeTombstones::inRange(candidate, key, end);
+                });
+            } else if (operation == "BLOB") {
+                walFile >> value;
+                blobs.addBlob(key, value);  // The second token of a BLOB record is its hash
+            } else if (operation == "PUTREF") {
+                walFile >> value;
+                if (blobs.assignExisting(key, value)) {
+                    db.erase(key);
+                    fields.erase(key);
+                }
+            } else if (operation == "HSET") {
+                walFile >> field >> value;
+                fields[key][field] = value;
+                db.erase(key);
+                blobs.release(key);
+            } else if (operation == "HDEL") {
+                walFile >> field;
+                auto it = fields.find(key);
+                if (it != fields.end() && it->second.erase(field) > 0 && it->second.empty()) {
+                    fields.erase(it);
+                }
+            }
+        }
+    }
+
+    // Move the current log aside so a checkpoint can run while new operations keep being logged.
+    // If an earlier checkpoint never finished, the current log is appended to the old segment.
+    void rotate() const {
+        ensureAttached();
+        if (mappedLog_) {
+            mappedLog_->close();  // Trim the preallocated space off the rotated segment
+            rotateFile();
+            mappedLog_->open();
+            return;
+        }
+        rotateFile();
+    }
+
+    // Stop appending so another process can take the log over (mapped mode trims the file first)
+    void detach() const {
+        if (mappedLog_) {
+            mappedLog_->close();
+        }
+        detached_ = true;
+    }
+
+    // Resume appending after a failed detach, or pick the log up after another process detached
+    // it: the end of the log and its size are read again from the file
+    void reopen() const {
+        if (mappedLog_) {
+            mappedLog_->close(false);
+            mappedLog_->open();
+        }
+        std::error_code ec;
+        uint64_t current = mappedLog_ ? mappedLog_->size() : std::filesystem::file_size(walFileName_, ec);
+        currentBytes_ = ec ? 0 : current;
+        uint64_t rotated = std::filesystem::file_size(rotatedFileName(), ec);
+        rotatedBytes_ = ec ? 0 : rotated;
+        detached_ = false;
+    }
+
+    // Make every logged record durable (msync in mapped mode, fdatasync of the file otherwise)
+    void sync() const {
+        if (mappedLog_) {
+            mappedLog_->sync();
+            return;
+        }
+        int fd = ::open(walFileName_.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fdatasync(fd);
+            ::close(fd);
+        }
+    }
+
+    // Append records received from a replication leader and make them durable
+    void appendReplicated(const std::string& records) const {
+        append(records);
+        sync();
+    }
+
+    // Ship every record appended from now on to the followers of a replication leader
+    void setLeader(ReplicationLeader* leader) { leader_ = leader; }
+
+    // Clear the rotated segment after its operations were merged into the main database
+    void clearLog() const {
+        ensureAttached();
+        std::filesystem::remove(rotatedFileName());
+        rotatedBytes_ = 0;
+    }
+
+    // Throw once the log was handed over: its files now belong to another process
+    void ensureAttached() const {
+        if (detached_) {
+            throw std::logic_error("WAL " + walFileName_ + " was handed over to another process");
+        }
+    }
+
+    // Bytes of log not yet covered by a completed checkpoint (the checkpoint debt)
+    [[nodiscard]] uint64_t pendingBytes() const { return currentBytes_ + rotatedBytes_; }
+
+private:
+    std::string rotatedFileName() const { return walFileName_ + ".old"; }
+
+    void rotateFile() const {
+        rotatedBytes_ += currentBytes_.exchange(0);
+        if (!std::filesystem::exists(rotatedFileName())) {
+            std::ofstream touch(walFileName_, std::ios_base::app);
+            touch.close();
+            std::filesystem::rename(walFileName_, rotatedFileName());
+            return;
+        }
+        bool rotatedFramed = MappedLog::isFramed(rotatedFileName());
+        std::ofstream rotatedFile(rotatedFileName(), std::ios_base::app | std::ios::binary);
+        if (!rotatedFramed && !MappedLog::isFramed(walFileName_)) {
+            std::ifstream walFile(walFileName_, std::ios::binary);
+            rotatedFile << walFile.rdbuf();
+        } else {
+            // Carry the records over in the rotated segment's own format
+            std::string records = MappedLog::readRecords(walFileName_);
+            if (!records.empty()) {
+                rotatedFile << (rotatedFramed ? MappedLog::frame(records) : records);
+            }
+        }
+        rotatedFile.close();
+        std::ofstream truncated(walFileName_, std::ios_base::trunc);
+        truncated.close();
+    }
+
+    // Append one record, reporting the I/O to the scheduler as foreground traffic
+    void append(const std::string& record) const {
+        ensureAttached();
+        auto start = std::chrono::steady_clock::now();
+        if (scheduler_ != nullptr) {
+            scheduler_->beginForeground();
+            scheduler_->acquire(IOClass::WalSync, record.size());
+        }
+        if (mappedLog_) {
+            mappedLog_->append(record);  // Reserve, memcpy and publish; no file write per record
+            if (syncOnCommit_) {
+                mappedLog_->sync();
+            }
+        } else {
+            std::ofstream walFile(walFileName_, std::ios_base::app);
+            walFile << record;
+            walFile.close();
+        }
+        currentBytes_ += record.size();
+        if (leader_ != nullptr) {
+            leader_->ship(record);
+        }
+        if (scheduler_ != nullptr) {
+            scheduler_->endForeground(std::chrono::steady_clock::now() - start);
+        }
+    }
+
+    std::string walFileName_;  // Name of the WAL file
+    IOScheduler* scheduler_;   // Optional scheduler that gives WAL I/O priority
+    bool syncOnCommit_;        // msync each record in mapped mode
+    std::unique_ptr<MappedLog> mappedLog_;           // Mapped backend, if enabled
+    mutable std::atomic<bool> detached_{false};      // Handed over; appends are refused
+    ReplicationLeader* leader_ = nullptr;            // Ships appended records to followers, if replicating
+    mutable std::atomic<uint64_t> currentBytes_{0};  // Size of the current log
+    mutable std::atomic<uint64_t> rotatedBytes_{0};  // Size of the rotated, not yet merged log
+};
+
+// Hash Snapshot Module: On-disk open-addressing hash table that can be mmapped and queried in place.
+// Layout: header | slots (hash, record offset) | records (keySize, valueSize, key, value).
+class HashSnapshot {
+public:
+    // Open and map an existing snapshot; valid() reports whether the file was usable
+    explicit HashSnapshot(const std::string& fileName) {
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= kHeaderSize) {
+            void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (addr != MAP_FAILED) {
+                base_ = static_cast<const char*>(addr);
+                size_ = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+        if (base_ == nullptr) {
+            return;
+        }
+        std::memcpy(&slotCount_, base_ + 8, 8);
+        std::memcpy(&entryCount_, base_ + 16, 8);
+        bool powerOfTwo = slotCount_ != 0 && (slotCount_ & (slotCount_ - 1)) == 0;
+        if (std::memcmp(base_, kMagic, 8) != 0 || !powerOfTwo || slotCount_ > (size_ - kHeaderSize) / kSlotSize) {
+            unmap();
+        }
+    }
+
+    ~HashSnapshot() { unmap(); }
+
+    HashSnapshot(const HashSnapshot&) = delete;
+    HashSnapshot& operator=(const HashSnapshot&) = delete;
+
+    // Write the in-memory database as a snapshot file, replaced durably via rename so that a failed
+    // write leaves the previous snapshot in place. Throws on failure.
+    static void write(const std::string& fileName, const std::unordered_map<std::string, std::string>& db) {
+        std::string tmpName = fileName + ".tmp";
+        std::ofstream snapFile(tmpName, std::ios::binary | std::ios::trunc);
+        writeTo(snapFile, db);
+        snapFile.close();
+        if (!snapFile) {
+            throw std::runtime_error("Cannot write " + tmpName);
+        }
+        renameDurably(tmpName, fileName);
+    }
+
+    // Write the snapshot format to an open stream
+    static void writeTo(std::ostream& snapFile, const std::unordered_map<std::string, std::string>& db) {
+        uint64_t slotCount = 16;
+        while (slotCount < db.size() * 2) {
+            slotCount <<= 1;  // Keep the load factor at or below one half
+        }
+        std::vector<uint64_t> slots(slotCount * 2, 0);
+        uint64_t offset = kHeaderSize + slotCount * kSlotSize;
+        for (const auto& pair : db) {
+            uint64_t hash = hashKey(pair.first);
+            uint64_t i = hash & (slotCount - 1);
+            while (slots[i * 2 + 1] != 0) {
+                i = (i + 1) & (slotCount - 1);
+            }
+            slots[i * 2] = hash;
+            slots[i * 2 + 1] = offset;
+            offset += 8 + pair.first.size() + pair.second.size();
+        }
+
+        uint64_t entryCount = db.size();
+        snapFile.write(kMagic, 8);
+        snapFile.write(reinterpret_cast<const char*>(&slotCount), 8);
+        snapFile.write(reinterpret_cast<const char*>(&entryCount), 8);
+        snapFile.write(reinterpret_cast<const char*>(&offset), 8);  // Total file size
+        snapFile.write(reinterpret_cast<const char*>(slots.data()), static_cast<std::streamsize>(slots.size() * 8));
+        for (const auto& pair : db) {  // Same iteration order as the offset pass above
+            uint32_t keySize = static_cast<uint32_t>(pair.first.size());
+            uint32_t valueSize = static_cast<uint32_t>(pair.second.size());
+            snapFile.write(reinterpret_cast<const char*>(&keySize), 4);
+            snapFile.write(reinterpret_cast<const char*>(&valueSize), 4);
+            snapFile.write(pair.first.data(), keySize);
+            snapFile.write(pair.second.data(), valueSize);
+        }
+    }
+
+    // Whether the snapshot was mapped and passed validation
+    [[nodiscard]] bool valid() const { return base_ != nullptr; }
+
+    // Number of key-value pairs in the snapshot
+    [[nodiscard]] uint64_t size() const { return entryCount_; }
+
+    // Look up a key; the returned view points into the mapping and lives as long as this object
+    [[nodiscard]] bool find(const std::string& key, std::string_view& value) const {
+        if (base_ == nullptr) {
+            return false;
+        }
+        uint64_t hash = hashKey(key);
+        for (uint64_t i = hash & (slotCount_ - 1);; i = (i + 1) & (slotCount_ - 1)) {
+            uint64_t slotHash, offset;
+            std::memcpy(&slotHash, base_ + kHeaderSize + i * kSlotSize, 8);
+            std::memcpy(&offset, base_ + kHeaderSize + i * kSlotSize + 8, 8);
+            if (offset == 0) {
+                return false;
+            }
+            std::string_view recordKey, recordValue;
+            if (slotHash == hash && readRecord(offset, recordKey, recordValue) && recordKey == key) {
+                value = recordValue;
+                return true;
+            }
+        }
+    }
+
+    // Retrieve the value associated with a key
+    [[nodiscard]] std::string get(const std::string& key) const {
+        std::string_view value;
+        return find(key, value) ? std::string(value) : "Key not found";
+    }
+
+    // Visit every key-value pair, e.g. to materialize the snapshot into a mutable table. Records
+    // are walked in file order, so the mapping is read sequentially.
+    template <typename Visitor>
+    void forEach(Visitor&& visit) const {
+        if (base_ == nullptr) {
+            return;
+        }
+        std::string_view key, value;
+        uint64_t offset = kHeaderSize + slotCount_ * kSlotSize;
+        for (uint64_t i = 0; i < entryCount_ && readRecord(offset, key, value); ++i) {
+            visit(key, value);
+            offset += 8 + key.size() + value.size();
+        }
+    }
+
+private:
+    static constexpr char kMagic[9] = "EXDBHSN1";
+    static constexpr uint64_t kHeaderSize = 32;
+    static constexpr uint64_t kSlotSize = 16;
+
+    bool readRecord(uint64_t offset, std::string_view& key, std::string_view& value) const {
+        uint32_t keySize, valueSize;
+        if (offset + 8 > size_) {
+            return false;
+        }
+        std::memcpy(&keySize, base_ + offset, 4);
+        std::memcpy(&valueSize, base_ + offset + 4, 4);
+        if (offset + 8 + keySize + valueSize > size_) {
+            return false;
+        }
+        key = std::string_view(base_ + offset + 8, keySize);
+        value = std::string_view(base_ + offset + 8 + keySize, valueSize);
+        return true;
+    }
+
+    void unmap() {
+        if (base_ != nullptr) {
+            ::munmap(const_cast<char*>(base_), size_);
+            base_ = nullptr;
+        }
+    }
+
+    const char* base_ = nullptr;  // Start of the read-only mapping
+    size_t size_ = 0;             // Length of the mapping
+    uint64_t slotCount_ = 0;      // Number of hash slots (power of two)
+    uint64_t entryCount_ = 0;     // Number of stored pairs
+};
+
+// Thresholds for write admission control, in bytes of WAL not yet covered by a checkpoint
+struct AdmissionOptions {
+    uint64_t softLimitBytes = 64ull << 20;                 // Writes start to be delayed above this debt
+    uint64_t hardLimitBytes = 256ull << 20;                // Delay reaches its maximum at this debt
+    std::chrono::microseconds maxDelay{10000};             // Upper bound on any single write delay
+};
+
+// Admission Control Module: Applies graduated, bounded delays to writes as checkpoint debt grows,
+// trading a little write latency for predictable tails instead of hard stalls
+class AdmissionController {
+public:
+    // Counters exposed to operators
+    struct Stats {
+        uint64_t pendingWalBytes = 0;   // Checkpoint debt observed by the last write
+        uint64_t delayedWrites = 0;     // Writes that were delayed at all
+        uint64_t writesAtLimit = 0;     // Writes delayed by the full maxDelay
+        uint64_t totalDelayMicros = 0;  // Sum of all delays
+        uint64_t maxDelayMicros = 0;    // Largest single delay
+    };
+
+    // Throws std::invalid_argument if the hard limit is below the soft limit or maxDelay is negative
+    explicit AdmissionController(const AdmissionOptions& options) : options_(options) {
+        if (options_.hardLimitBytes < options_.softLimitBytes) {
+            throw std::invalid_argument("Admission hardLimitBytes " + std::to_string(options_.hardLimitBytes) +
+                                        " is below softLimitBytes " + std::to_string(options_.softLimitBytes));
+        }
+        if (options_.maxDelay.count() < 0) {
+            throw std::invalid_argument("Admission maxDelay must not be negative");
+        }
+    }
+
+    // Delay the calling writer according to the current checkpoint debt. Must be called
+    // without holding the database lock so that readers and the checkpoint keep running.
+    void admit(uint64_t pendingWalBytes) {
+        std::chrono::microseconds delay = delayFor(pendingWalBytes);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.pendingWalBytes = pendingWalBytes;
+            if (delay.count() == 0) {
+                return;
+            }
+            ++stats_.delayedWrites;
+            stats_.writesAtLimit += delay >= options_.maxDelay ? 1 : 0;
+            stats_.totalDelayMicros += static_cast<uint64_t>(delay.count());
+            stats_.maxDelayMicros = std::max(stats_.maxDelayMicros, static_cast<uint64_t>(delay.count()));
+        }
+        std::this_thread::sleep_for(delay);
+    }
+
+    // Delay for a given debt: zero below the soft limit, then rising quadratically to maxDelay
+    [[nodiscard]] std::chrono::microseconds delayFor(uint64_t pendingWalBytes) const {
+        if (pendingWalBytes <= options_.softLimitBytes) {
+            return std::chrono::microseconds(0);
+        }
+        double range = static_cast<double>(std::max<uint64_t>(options_.hardLimitBytes - options_.softLimitBytes, 1));
+        double fraction = std::min(static_cast<double>(pendingWalBytes - options_.softLimitBytes) / range, 1.0);
+        return std::chrono::microseconds(
+            static_cast<int64_t>(static_cast<double>(options_.maxDelay.count()) * fraction * fraction));
+    }
+
+    // Snapshot of the admission counters
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    AdmissionOptions options_;
+    Stats stats_;
+    std::mutex mutex_;
+};
+
+// Hot-Key Tracker Module: Finds the most frequently accessed keys at low cost. One in sampleRate
+// accesses updates a Count-Min sketch; keys whose estimate beats the smallest of the current top
+// K enter a small min-heap of heavy hitters. Counts are halved periodically so the report follows
+// the recent workload. Estimates are approximate (never below the sampled count).
+class HotKeyTracker {
+public:
+    struct HotKey {
+        std::string key;
+        uint64_t estimatedAccesses;  // Scaled back up by the sampling rate
+    };
+
+    explicit HotKeyTracker(size_t sampleRate = 16, size_t topK = 16, uint64_t decayInterval = 1 << 16)
+        : sampleRate_(std::max<size_t>(sampleRate, 1)), topK_(std::max<size_t>(topK, 1)),
+          decayInterval_(std::max<uint64_t>(decayInterval, 1)), counters_(kDepth * kWidth) {}
+
+    // Count one access to key (only one in sampleRate accesses does any work); returns true if
+    // this access was sampled and the key is among the heavy hitters
+    bool record(const std::string& key) {
+        Ticks& ticks = ticks_[std::hash<std::thread::id>{}(std::this_thread::get_id()) % kTickStripes];
+        if (ticks.count.fetch_add(1, std::memory_order_relaxed) % sampleRate_ != sampleRate_ - 1) {
+            return false;
+        }
+        uint64_t hash = hashKey(key);
+        uint32_t estimate = std::numeric_limits<uint32_t>::max();
+        for (size_t row = 0; row < kDepth; ++row) {
+            std::atomic<uint32_t>& counter = counters_[row * kWidth + cell(hash, row)];
+            estimate = std::min(estimate, counter.fetch_add(1, std::memory_order_relaxed) + 1);
+        }
+        bool hot = estimate > minimum_.load(std::memory_order_relaxed) && offer(key, estimate);
+        if (samples_.fetch_add(1, std::memory_order_relaxed) % decayInterval_ == decayInterval_ - 1) {
+            decay();
+        }
+        return hot;
+    }
+
+    // Heavy hitters, hottest first
+    [[nodiscard]] std::vector<HotKey> top() const {
+        std::vector<HotKey> result;
+        {
+            std::lock_guard<std::mutex> lock(heapMutex_);
+            for (const Candidate& candidate : heap_) {
+                result.push_back({candidate.key, candidate.count * sampleRate_});
+            }
+        }
+        std::sort(result.begin(), result.end(),
+                  [](const HotKey& a, const HotKey& b) { return a.estimatedAccesses > b.estimatedAccesses; });
+        return result;
+    }
+
+    // Whether key is currently among the heavy hitters
+    [[nodiscard]] bool isHot(const std::string& key) const {
+        std::lock_guard<std::mutex> lock(heapMutex_);
+        return std::any_of(heap_.begin(), heap_.end(), [&key](const Candidate& c) { return c.key == key; });
+    }
+
+    // Number of sampled accesses so far
+    [[nodiscard]] uint64_t samples() const { return samples_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t kDepth = 4;
+    static constexpr size_t kWidth = 4096;
+    static constexpr size_t kTickStripes = 16;
+
+    // Access counter of the threads hashed to one stripe, on its own cache line
+    struct alignas(64) Ticks {
+        std::atomic<uint64_t> count{0};
+    };
+
+    struct Candidate {
+        std::string key;
+        uint64_t count;
+    };
+
+    static bool heavier(const Candidate& a, const Candidate& b) { return a.count > b.count; }  // Min-heap order
+
+    // Row-specific cell from one 64-bit hash (double hashing)
+    static size_t cell(uint64_t hash, size_t row) {
+        uint64_t mixed = (hash + row * ((hash >> 32) | 1)) * 0x9e3779b97f4a7c15ull;
+        return static_cast<size_t>(mixed >> 52) & (kWidth - 1);
+    }
+
+    // Update or insert a candidate, evicting the coldest heavy hitter when the heap is full;
+    // returns whether the key is a heavy hitter afterwards
+    bool offer(const std::string& key, uint64_t estimate) {
+        bool hot = true;
+        std::lock_guard<std::mutex> lock(heapMutex_);
+        auto it = std::find_if(heap_.begin(), heap_.end(), [&key](const Candidate& c) { return c.key == key; });
+        if (it != heap_.end()) {
+            it->count = std::max(it->count, estimate);
+            std::make_heap(heap_.begin(), heap_.end(), heavier);
+        } else if (heap_.size() < topK_) {
+            heap_.push_back({key, estimate});
+            std::push_heap(heap_.begin(), heap_.end(), heavier);
+        } else if (estimate > heap_.front().count) {
+            std::pop_heap(heap_.begin(), heap_.end(), heavier);
+            heap_.back() = {key, estimate};
+            std::push_heap(heap_.begin(), heap_.end(), heavier);
+        } else {
+            hot = false;
+        }
+        minimum_.store(heap_.size() < topK_ ? 0 : heap_.front().count, std::memory_order_relaxed);
+        return hot;
+    }
+
+    // Halve every counter so old accesses fade out
+    void decay() {
+        for (std::atomic<uint32_t>& counter : counters_) {
+            counter.store(counter.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+        }
+        std::lock_guard<std::mutex> lock(heapMutex_);
+        for (Candidate& candidate : heap_) {
+            candidate.count /= 2;
+        }
+        minimum_.store(heap_.size() < topK_ ? 0 : heap_.front().count, std::memory_order_relaxed);
+    }
+
+    const size_t sampleRate_;
+    const size_t topK_;
+    const uint64_t decayInterval_;                  // Samples between halvings
+    std::vector<std::atomic<uint32_t>> counters_;   // Count-Min sketch, kDepth rows of kWidth cells
+    std::array<Ticks, kTickStripes> ticks_;         // Accesses of this tracker, striped by thread
+    std::atomic<uint64_t> samples_{0};
+    std::atomic<uint64_t> minimum_{0};              // Smallest heavy-hitter count once the heap is full
+    mutable std::mutex heapMutex_;
+    std::vector<Candidate> heap_;                   // Min-heap of heavy hitters
+};
+
+// Per-Core Replica Module: Read-only copies of hot keys, one small map per CPU. A reader only locks
+// the map of the CPU it runs on, so reads of a hot key from many cores stop bouncing the table lock's
+// cache line. Copies are filled under the table's shared lock and invalidated under its exclusive
+// lock, so a replica never outlives the value it copied.
+class ReadReplicas {
+public:
+    explicit ReadReplicas(size_t capacity)
+        : capacity_(std::max<size_t>(capacity, 1)), cores_(std::max(1u, std::thread::hardware_concurrency())) {}
+
+    // Copy of key on the calling CPU, if any
+    bool lookup(const std::string& key, std::string& value) {
+        Core& core = local();
+        std::lock_guard<std::mutex> lock(core.mutex);
+        auto it = core.values.find(key);
+        if (it == core.values.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    // Copy key to the calling CPU's map; the caller holds the table's shared lock
+    void fill(const std::string& key, const std::string& value) {
+        {
+            std::lock_guard<std::mutex> lock(fillMutex_);
+            if (replicated_.size() >= capacity_ * 4) {
+                clearLocked();  // Stale promotions piled up; start over from the current hot set
+            }
+            replicated_.insert(key);
+        }
+        Core& core = local();
+        std::lock_guard<std::mutex> lock(core.mutex);
+        if (core.values.size() >= capacity_) {
+            core.values.clear();
+        }
+        core.values[key] = value;
+    }
+
+    // Drop every copy of key; the caller holds the table's exclusive lock, so no fill is running
+    void invalidate(const std::string& key) {
+        if (replicated_.erase(key) == 0) {
+            return;  // Never replicated: no per-core work
+        }
+        for (Core& core : cores_) {
+            std::lock_guard<std::mutex> lock(core.mutex);
+            core.values.erase(key);
+        }
+    }
+
+    // Drop every copy of the keys a predicate matches (range deletes); the caller holds the table's
+    // exclusive lock
+    template <typename Predicate>
+    void invalidateWhere(Predicate&& matches) {
+        std::vector<std::string> keys;
+        for (const std::string& key : replicated_) {
+            if (matches(key)) {
+                keys.push_back(key);
+            }
+        }
+        for (const std::string& key : keys) {
+            invalidate(key);
+        }
+    }
+
+    // Drop every copy (a restored table); the caller holds the table's exclusive lock
+    void clear() {
+        std::lock_guard<std::mutex> lock(fillMutex_);
+        clearLocked();
+    }
+
+private:
+    struct alignas(64) Core {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::string> values;
+    };
+
+    Core& local() {
+        int cpu = sched_getcpu();
+        return cores_[static_cast<size_t>(cpu < 0 ? 0 : cpu) % cores_.size()];
+    }
+
+    void clearLocked() {
+        for (Core& core : cores_) {
+            std::lock_guard<std::mutex> lock(core.mutex);
+            core.values.clear();
+        }
+        replicated_.clear();
+    }
+
+    const size_t capacity_;                        // Copies kept per CPU
+    std::vector<Core> cores_;
+    std::mutex fillMutex_;                         // Serializes fills, which run under the shared lock
+    std::unordered_set<std::string> replicated_;   // Keys that may have copies
+};
+
+// Raft log entry: WAL records applied together (empty for the no-op a new leader appends)
+struct RaftEntry {
+    uint64_t term = 0;
+    std::string record;
+};
+
+// Raft Message: One message between Raft nodes. index and logTerm name the entry before the sent
+// entries (AppendEntries), the candidate's last entry (RequestVote), the snapshot's last entry
+// (InstallSnapshot), or the matched or suggested next-lower index (replies).
+struct RaftMessage {
+    enum class Type { RequestVote, Vote, AppendEntries, AppendResult, InstallSnapshot, SnapshotResult };
+    Type type = Type::AppendEntries;
+    int from = -1;
+    int to = -1;
+    uint64_t term = 0;
+    uint64_t index = 0;
+    uint64_t logTerm = 0;
+    uint64_t commit = 0;            // Leader's commit index (AppendEntries)
+    bool success = false;           // Vote granted, entries appended or snapshot installed
+    int64_t sentAt = 0;             // Leader's send time, echoed by replies for leader leases
+    std::vector<RaftEntry> entries; // Entries after index (AppendEntries)
+    std::string snapshot;           // Table contents as WAL records (InstallSnapshot)
+};
+
+// Simulated Network Module: Delivers Raft messages between nodes of one process after a random
+// delay, optionally dropping some and cutting nodes off, so clusters can be tested without sockets.
+// Messages are delivered one at a time by a single thread, possibly out of order.
+class SimulatedNetwork {
+public:
+    using Handler = std::function<void(const RaftMessage&)>;
+
+    explicit SimulatedNetwork(std::chrono::microseconds minDelay = std::chrono::microseconds(100),
+                              std::chrono::microseconds maxDelay = std::chrono::microseconds(500), double dropRate = 0)
+        : minDelay_(minDelay), maxDelay_(std::max(minDelay, maxDelay)), dropRate_(dropRate) {
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~SimulatedNetwork() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+    SimulatedNetwork(const SimulatedNetwork&) = delete;
+    SimulatedNetwork& operator=(const SimulatedNetwork&) = delete;
+
+    // Deliver messages addressed to node to handler
+    void attach(int node, Handler handler) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        handlers_[node] = std::move(handler);
+    }
+
+    // Stop delivering to node; returns once no delivery to it is in progress
+    void detach(int node) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            handlers_.erase(node);
+        }
+        std::lock_guard<std::mutex> delivery(deliveryMutex_);
+    }
+
+    // Queue a message; it is lost if either end is cut off when it is sent or delivered
+    void send(RaftMessage message) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cutOff(message) || std::uniform_real_distribution<double>(0, 1)(random_) < dropRate_) {
+            ++dropped_;
+            return;
+        }
+        auto delay = std::uniform_int_distribution<int64_t>(minDelay_.count(), maxDelay_.count())(random_);
+        queue_.push(Pending{std::chrono::steady_clock::now() + std::chrono::microseconds(delay), sequence_++,
+                            std::move(message)});
+        wake_.notify_one();
+    }
+
+    // Cut a node off from every other node, or reconnect all nodes
+    void isolate(int node) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isolated_.insert(node);
+    }
+
+    void heal() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isolated_.clear();
+    }
+
+    void setDropRate(double dropRate) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dropRate_ = dropRate;
+    }
+
+    [[nodiscard]] uint64_t dropped() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return dropped_;
+    }
+
+private:
+    struct Pending {
+        std::chrono::steady_clock::time_point deliverAt;
+        uint64_t sequence;
+        RaftMessage message;
+
+        bool operator>(const Pending& other) const {
+            return deliverAt != other.deliverAt ? deliverAt > other.deliverAt : sequence > other.sequence;
+        }
+    };
+
+    bool cutOff(const RaftMessage& message) const {
+        return isolated_.count(message.from) > 0 || isolated_.count(message.to) > 0;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            if (queue_.empty()) {
+                wake_.wait(lock);
+                continue;
+            }
+            std::chrono::steady_clock::time_point deliverAt = queue_.top().deliverAt;
+            if (deliverAt > std::chrono::steady_clock::now()) {
+                wake_.wait_until(lock, deliverAt);
+                continue;
+            }
+            RaftMessage message = queue_.top().message;
+            queue_.pop();
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> delivery(deliveryMutex_);  // detach waits for this delivery
+                Handler handler;
+                {
+                    std::lock_guard<std::mutex> relock(mutex_);
+                    auto it = handlers_.find(message.to);
+                    if (it != handlers_.end() && !cutOff(message)) {
+                        handler = it->second;
+                    } else {
+                        ++dropped_;
+                    }
+                }
+                if (handler) {
+                    handler(message);
+                }
+            }
+            lock.lock();
+        }
+    }
+
+    std::chrono::microseconds minDelay_;
+    std::chrono::microseconds maxDelay_;
+    double dropRate_;
+    std::map<int, Handler> handlers_;
+    std::unordered_set<int> isolated_;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<>> queue_;
+    uint64_t sequence_ = 0;
+    uint64_t dropped_ = 0;
+    std::mt19937_64 random_{std::random_device{}()};
+    bool stopping_ = false;
+    mutable std::mutex mutex_;
+    std::mutex deliveryMutex_;       // Held while a handler runs
+    std::condition_variable wake_;
+    std::thread thread_;
+};
+
+// Raft configuration of one node
+struct RaftOptions {
+    int nodeId = -1;                  // This node's id (-1 = Raft off)
+    std::vector<int> peers;           // Ids of the other nodes of the cluster
+    SimulatedNetwork* network = nullptr;             // Carries messages between the nodes
+    std::chrono::milliseconds electionTimeout{150};  // Minimum; each node waits a random time up to twice this
+    std::chrono::milliseconds heartbeatInterval{30};
+    size_t maxBatchEntries = 4096;    // Entries per AppendEntries message
+    size_t maxInflight = 8;           // AppendEntries sent to a follower ahead of its acknowledgements
+    bool syncLog = true;              // fdatasync the Raft log before entries count as stored
+};
+
+// Role and progress of a Raft node
+struct RaftStatus {
+    enum class Role { Follower, Candidate, Leader };
+    Role role = Role::Follower;
+    uint64_t term = 0;
+    int leader = -1;                // Known leader, -1 if none
+    uint64_t lastIndex = 0;         // Last log entry
+    uint64_t commitIndex = 0;
+    uint64_t lastApplied = 0;
+    uint64_t snapshotIndex = 0;     // Last entry covered by the snapshot (compacted away)
+    uint64_t logFlushes = 0;        // Log writes; each stores every entry proposed since the last one
+    uint64_t leaseReads = 0;        // Linearizable reads served under the leader lease
+    uint64_t readIndexReads = 0;    // Linearizable reads that needed a heartbeat round
+};
+
+// Raft Module: Replicates a log of WAL records across a cluster and applies committed entries in
+// order. Entries are stored in <log file> as "index term size\n" followed by the records; the term,
+// vote and snapshot position live in <state file>. Proposals that arrive while the log is being
+// written are stored with the next write (group commit), and a leader keeps up to maxInflight
+// AppendEntries in flight to each follower. Once the state machine has saved a snapshot, compact()
+// drops the entries it covers; followers that need them get the snapshot instead. A leader serves
+// linearizable reads without a round trip while a majority acknowledged a heartbeat within the
+// last 0.9 election timeouts (a leader lease): nodes that heard from a leader within the election
+// timeout neither start elections nor vote, and neither does a node that started within the last
+// election timeout, since it may have granted a lease before a restart.
+class RaftNode {
+public:
+    using ApplyFunction = std::function<void(uint64_t lastIndex, const std::string& records)>;
+    using SnapshotFunction = std::function<uint64_t(std::string& records)>;  // Returns the applied index
+    using RestoreFunction = std::function<void(uint64_t index, const std::string& records)>;
+
+    // Load the persistent state; the caller restores the state machine up to snapshotIndex and
+    // then calls start(). The timer and apply threads are pinned to numaNode's CPUs when it is not -1.
+    RaftNode(const RaftOptions& options, std::string logFileName, std::string stateFileName, ApplyFunction apply,
+             SnapshotFunction snapshot, RestoreFunction restore, int numaNode = -1)
+        : id_(options.nodeId), network_(options.network), electionTimeout_(options.electionTimeout),
+          heartbeatInterval_(options.heartbeatInterval), maxBatchEntries_(std::max<size_t>(options.maxBatchEntries, 1)),
+          maxInflight_(std::max<size_t>(options.maxInflight, 1)), syncLog_(options.syncLog),
+          logFileName_(std::move(logFileName)), stateFileName_(std::move(stateFileName)), apply_(std::move(apply)),
+          snapshot_(std::move(snapshot)), restore_(std::move(restore)), numaNode_(numaNode) {
+        if (network_ == nullptr) {
+            throw std::invalid_argument("Raft node " + std::to_string(id_) + " has no network");
+        }
+        for (int peer : options.peers) {
+            peers_.push_back(Peer{peer});
+        }
+        loadState();
+        loadLog();
+        commitIndex_ = lastApplied_ = snapshotIndex_;
+    }
+
+    ~RaftNode() {
+        network_->detach(id_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        tick_.notify_all();
+        work_.notify_all();
+        changed_.notify_all();
+        if (ticker_.joinable()) {
+            ticker_.join();
+            applier_.join();
+        }
+    }
+
+    RaftNode(const RaftNode&) = delete;
+    RaftNode& operator=(const RaftNode&) = delete;
+
+    // Start receiving messages, timers and applying committed entries
+    void start() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lastHeardLeader_ = Clock::now();  // A leader we acknowledged before restarting may still hold a lease
+        resetElectionDeadline();
+        ticker_ = std::thread([this] { runTimers(); });
+        applier_ = std::thread([this] { runApplier(); });
+        network_->attach(id_, [this](const RaftMessage& message) { receive(message); });
+    }
+
+    [[nodiscard]] uint64_t snapshotIndex() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return snapshotIndex_;
+    }
+
+    // Append records to the log as the leader and wait until they are committed and applied.
+    // Throws std::runtime_error if this node is not the leader, or loses leadership before the
+    // entry is applied (the entry may still be committed by the next leader). Returns the
+    // entry's index.
+    uint64_t replicate(const std::string& records) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        requireLeader();
+        uint64_t term = term_;
+        log_.push_back(RaftEntry{term, records});
+        uint64_t index = lastIndex();
+        flush(lock, index);  // Stores every entry proposed so far with one write
+        changed_.wait(lock, [&] { return stopping_ || lastApplied_ >= index || role_ != RaftStatus::Role::Leader || term_ != term; });
+        if (lastApplied_ < index || (index > snapshotIndex_ && termAt(index) != term)) {
+            throw std::runtime_error("Raft node " + std::to_string(id_) + " lost leadership before the write was applied");
+        }
+        return index;
+    }
+
+    // Make a following local read linearizable: confirm leadership (by lease, or by a heartbeat
+    // round acknowledged by a majority) and wait until everything committed so far is applied.
+    void readBarrier() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        requireLeader();
+        uint64_t term = term_;
+        changed_.wait_for(lock, electionTimeout_, [&] { return role_ != RaftStatus::Role::Leader || term_ != term || commitIndex_ >= termStartIndex_; });
+        requireLeader();
+        if (term_ != term || commitIndex_ < termStartIndex_) {
+            throw std::runtime_error("Raft node " + std::to_string(id_) + " has not committed an entry of its term");
+        }
+        uint64_t readIndex = commitIndex_;
+        if (leaseValid()) {
+            ++leaseReads_;
+        } else {
+            int64_t start = nowNanos();
+            for (Peer& peer : peers_) {
+                sendAppend(peer, true);
+            }
+            bool confirmed = changed_.wait_for(lock, electionTimeout_, [&] {
+                return role_ != RaftStatus::Role::Leader || term_ != term || majorityAckedSince() >= start;
+            });
+            if (!confirmed || role_ != RaftStatus::Role::Leader || term_ != term) {
+                throw std::runtime_error("Raft node " + std::to_string(id_) + " could not confirm its leadership");
+            }
+            ++readIndexReads_;
+        }
+        changed_.wait(lock, [&] { return stopping_ || lastApplied_ >= readIndex; });
+    }
+
+    // Drop log entries up to index, which the state machine has saved in a snapshot
+    void compact(uint64_t index) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waitForFlush(lock);
+        index = std::min(index, lastApplied_);
+        if (index <= snapshotIndex_) {
+            return;
+        }
+        snapshotTerm_ = termAt(index);
+        log_.erase(log_.begin(), log_.begin() + static_cast<std::ptrdiff_t>(index - snapshotIndex_));
+        snapshotIndex_ = index;
+        saveState();
+        rewriteLog();
+    }
+
+    RaftStatus status() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        RaftStatus status;
+        status.role = role_;
+        status.term = term_;
+        status.leader = leader_;
+        status.lastIndex = lastIndex();
+        status.commitIndex = commitIndex_;
+        status.lastApplied = lastApplied_;
+        status.snapshotIndex = snapshotIndex_;
+        status.logFlushes = logFlushes_;
+        status.leaseReads = leaseReads_;
+        status.readIndexReads = readIndexReads_;
+        return status;
+    }
+
+private:
+    struct Peer {
+        int id;
+        uint64_t nextIndex = 1;
+        uint64_t matchIndex = 0;
+        size_t inflight = 0;            // AppendEntries not yet answered
+        uint64_t matchAtHeartbeat = 0;  // matchIndex when the previous heartbeat went out
+        bool snapshotSent = false;
+        std::chrono::steady_clock::time_point lastContact{};
+        std::chrono::steady_clock::time_point snapshotSentAt{};
+        int64_t ackedSentAt = 0;        // Send time of the latest heartbeat it acknowledged
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    static int64_t nowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t lastIndex() const { return snapshotIndex_ + log_.size(); }
+
+    uint64_t termAt(uint64_t index) const {
+        if (index == snapshotIndex_) {
+            return snapshotTerm_;
+        }
+        return index > snapshotIndex_ && index <= lastIndex() ? log_[index - snapshotIndex_ - 1].term : 0;
+    }
+
+    RaftMessage makeMessage(RaftMessage::Type type, int to) const {
+        RaftMessage message;
+        message.type = type;
+        message.from = id_;
+        message.to = to;
+        message.term = term_;
+        return message;
+    }
+
+    size_t majority() const { return (peers_.size() + 1) / 2 + 1; }
+
+    void requireLeader() const {
+        if (stopping_ || role_ != RaftStatus::Role::Leader) {
+            throw std::runtime_error("Raft node " + std::to_string(id_) + " is not the leader (leader: " +
+                                     std::to_string(leader_) + ")");
+        }
+    }
+
+    void resetElectionDeadline() {
+        std::uniform_int_distribution<int64_t> jitter(0, electionTimeout_.count());
+        electionDeadline_ = Clock::now() + electionTimeout_ + std::chrono::milliseconds(jitter(random_));
+    }
+
+    // Send time of the latest heartbeat a majority (this node included) acknowledged
+    int64_t majorityAckedSince() const {
+        std::vector<int64_t> acked{std::numeric_limits<int64_t>::max()};
+        for (const Peer& peer : peers_) {
+            acked.push_back(peer.ackedSentAt);
+        }
+        std::sort(acked.begin(), acked.end(), std::greater<>());
+        return acked[majority() - 1];
+    }
+
+    bool leaseValid() const {
+        auto lease = std::chrono::duration_cast<std::chrono::nanoseconds>(electionTimeout_) * 9 / 10;
+        return role_ == RaftStatus::Role::Leader && commitIndex_ >= termStartIndex_ &&
+               (peers_.empty() || majorityAckedSince() + lease.count() > nowNanos());
+    }
+
+    // Message handling, called by the network thread
+
+    void receive(const RaftMessage& message) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        switch (message.type) {
+            case RaftMessage::Type::RequestVote: onRequestVote(message); break;
+            case RaftMessage::Type::Vote: onVote(message, lock); break;
+            case RaftMessage::Type::AppendEntries: onAppendEntries(message, lock); break;
+            case RaftMessage::Type::AppendResult: onAppendResult(message); break;
+            case RaftMessage::Type::InstallSnapshot: onInstallSnapshot(message); break;
+            case RaftMessage::Type::SnapshotResult: onSnapshotResult(message); break;
+        }
+    }
+
+    void stepDown(uint64_t term) {
+        if (term > term_) {
+            term_ = term;
+            votedFor_ = -1;
+            saveState();
+        }
+        if (role_ != RaftStatus::Role::Follower) {
+            role_ = RaftStatus::Role::Follower;
+            changed_.notify_all();
+        }
+    }
+
+    // Accept a message from the leader of its term
+    bool acceptLeader(const RaftMessage& message) {
+        if (message.term < term_) {
+            return false;
+        }
+        stepDown(message.term);
+        leader_ = message.from;
+        lastHeardLeader_ = Clock::now();
+        resetElectionDeadline();
+        return true;
+    }
+
+    void onRequestVote(const RaftMessage& message) {
+        bool leaderAlive = role_ == RaftStatus::Role::Leader || Clock::now() - lastHeardLeader_ < electionTimeout_;
+        RaftMessage reply = makeMessage(RaftMessage::Type::Vote, message.from);
+        if (message.term > term_ && !leaderAlive) {
+            stepDown(message.term);
+            leader_ = -1;
+        }
+        uint64_t lastTerm = termAt(lastIndex());
+        bool upToDate = message.logTerm > lastTerm || (message.logTerm == lastTerm && message.index >= lastIndex());
+        if (message.term == term_ && (votedFor_ < 0 || votedFor_ == message.from) && upToDate && !leaderAlive) {
+            votedFor_ = message.from;
+            saveState();
+            resetElectionDeadline();
+            reply.success = true;
+        }
+        reply.term = term_;
+        network_->send(std::move(reply));
+    }
+
+    void onVote(const RaftMessage& message, std::unique_lock<std::mutex>& lock) {
+        if (message.term > term_) {
+            stepDown(message.term);
+            return;
+        }
+        if (role_ == RaftStatus::Role::Candidate && message.term == term_ && message.success &&
+            ++votes_ >= majority()) {
+            becomeLeader(lock);
+        }
+    }
+
+    void onAppendEntries(const RaftMessage& message, std::unique_lock<std::mutex>& lock) {
+        waitForFlush(lock);
+        RaftMessage reply = makeMessage(RaftMessage::Type::AppendResult, message.from);
+        reply.sentAt = message.sentAt;
+        if (!acceptLeader(message)) {
+            network_->send(std::move(reply));
+            return;
+        }
+        reply.term = term_;
+        uint64_t previous = message.index;
+        if (previous > lastIndex()) {
+            reply.index = lastIndex();  // Resume after our last entry
+            network_->send(std::move(reply));
+            return;
+        }
+        if (previous > snapshotIndex_ && termAt(previous) != message.logTerm) {
+            // Resume before the conflicting term, but never below committed entries
+            uint64_t conflicting = termAt(previous);
+            uint64_t hint = previous - 1;
+            while (hint > commitIndex_ && hint > snapshotIndex_ && termAt(hint) == conflicting) {
+                --hint;
+            }
+            reply.index = hint;
+            network_->send(std::move(reply));
+            return;
+        }
+        uint64_t index = previous;
+        bool truncated = false;
+        for (const RaftEntry& entry : message.entries) {
+            ++index;
+            if (index <= snapshotIndex_ || (index <= lastIndex() && termAt(index) == entry.term)) {
+                continue;  // Already stored
+            }
+            if (index <= lastIndex()) {
+                log_.resize(index - snapshotIndex_ - 1);  // Drop the conflicting suffix
+                truncated = true;
+            }
+            log_.push_back(entry);
+        }
+        if (truncated) {
+            rewriteLog();
+        } else if (durableIndex_ < lastIndex()) {
+            appendLog();
+        }
+        reply.success = true;
+        reply.index = index;
+        if (std::min(message.commit, index) > commitIndex_) {
+            commitIndex_ = std::min(message.commit, index);
+            work_.notify_one();
+        }
+        network_->send(std::move(reply));
+    }
+
+    void onAppendResult(const RaftMessage& message) {
+        if (message.term > term_) {
+            stepDown(message.term);
+            return;
+        }
+        Peer* peer = findPeer(message.from);
+        if (role_ != RaftStatus::Role::Leader || message.term < term_ || peer == nullptr) {
+            return;
+        }
+        peer->lastContact = Clock::now();
+        peer->inflight -=  peer->inflight > 0 ? 1 : 0;
+        if (message.success) {
+            peer->ackedSentAt = std::max(peer->ackedSentAt, message.sentAt);
+            peer->matchIndex = std::max(peer->matchIndex, message.index);
+            peer->nextIndex = std::max(peer->nextIndex, peer->matchIndex + 1);
+            advanceCommit();
+            changed_.notify_all();  // Read barriers wait for acknowledgements
+        } else if (message.index >= peer->matchIndex) {
+            peer->nextIndex = std::min(peer->nextIndex, message.index + 1);
+            peer->inflight = 0;
+        }
+        if (peer->nextIndex <= lastIndex() && peer->inflight < maxInflight_) {
+            sendAppend(*peer, false);
+        }
+    }
+
+    void onInstallSnapshot(const RaftMessage& message) {
+        if (!acceptLeader(message)) {
+            network_->send(makeMessage(RaftMessage::Type::SnapshotResult, message.from));
+            return;
+        }
+        if (message.index <= commitIndex_) {
+            RaftMessage reply = makeMessage(RaftMessage::Type::SnapshotResult, message.from);
+            reply.index = commitIndex_;
+            reply.success = true;
+            network_->send(std::move(reply));
+            return;
+        }
+        pendingSnapshot_ = std::make_unique<RaftMessage>(message);  // Installed by the applier thread
+        work_.notify_one();
+    }
+
+    void onSnapshotResult(const RaftMessage& message) {
+        if (message.term > term_) {
+            stepDown(message.term);
+            return;
+        }
+        Peer* peer = findPeer(message.from);
+        if (role_ != RaftStatus::Role::Leader || message.term < term_ || peer == nullptr) {
+            return;
+        }
+        peer->snapshotSent = false;
+        peer->lastContact = Clock::now();
+        if (message.success) {
+            peer->matchIndex = std::max(peer->matchIndex, message.index);
+            peer->nextIndex = peer->matchIndex + 1;
+            peer->inflight = 0;
+            advanceCommit();
+            sendAppend(*peer, false);
+        }
+    }
+
+    Peer* findPeer(int id) {
+        for (Peer& peer : peers_) {
+            if (peer.id == id) {
+                return &peer;
+            }
+        }
+        return nullptr;
+    }
+
+    // Leader side
+
+    void becomeLeader(std::unique_lock<std::mutex>& lock) {
+        role_ = RaftStatus::Role::Leader;
+        leader_ = id_;
+        for (Peer& peer : peers_) {
+            peer = Peer{peer.id, lastIndex() + 1};
+            peer.lastContact = Clock::now();
+        }
+        log_.push_back(RaftEntry{term_, ""});  // Commits the entries of earlier terms
+        termStartIndex_ = lastIndex();
+        nextHeartbeat_ = Clock::now();
+        tick_.notify_all();  // The timer thread switches to heartbeats
+        changed_.notify_all();
+        flush(lock, termStartIndex_);
+    }
+
+    // Write the log up to index, then replicate. The write runs without the lock, so entries
+    // proposed meanwhile are written together by the next flush (group commit).
+    void flush(std::unique_lock<std::mutex>& lock, uint64_t index) {
+        while (durableIndex_ < std::min(index, lastIndex())) {
+            if (flushing_) {
+                changed_.wait(lock, [&] { return !flushing_; });
+                continue;
+            }
+            flushing_ = true;
+            uint64_t last = lastIndex();
+            std::string buffer = encode(durableIndex_ + 1, last);
+            lock.unlock();
+            bool written = writeLog(buffer);
+            lock.lock();
+            flushing_ = false;
+            changed_.notify_all();
+            if (!written) {
+                throw std::runtime_error("Cannot write Raft log " + logFileName_);
+            }
+            durableIndex_ = std::max(durableIndex_, last);
+            ++logFlushes_;
+            if (role_ == RaftStatus::Role::Leader) {
+                advanceCommit();
+                for (Peer& peer : peers_) {
+                    if (peer.inflight < maxInflight_) {
+                        sendAppend(peer, false);
+                    }
+                }
+            }
+        }
+    }
+
+    // Log files are only changed by one thread at a time; flush writes without holding the lock
+    void waitForFlush(std::unique_lock<std::mutex>& lock) {
+        changed_.wait(lock, [&] { return !flushing_; });
+    }
+
+    void advanceCommit() {
+        std::vector<uint64_t> matched{durableIndex_};
+        for (const Peer& peer : peers_) {
+            matched.push_back(peer.matchIndex);
+        }
+        std::sort(matched.begin(), matched.end(), std::greater<>());
+        uint64_t index = matched[majority() - 1];
+        if (index > commitIndex_ && termAt(index) == term_) {  // Only entries of this term commit by counting
+            commitIndex_ = index;
+            work_.notify_one();
+            changed_.notify_all();
+        }
+    }
+
+    // Send the next entries to a peer (a heartbeat carries none), or the snapshot if they were compacted
+    void sendAppend(Peer& peer, bool heartbeat) {
+        if (!heartbeat && peer.snapshotSent && Clock::now() - peer.snapshotSentAt < electionTimeout_ * 4) {
+            return;  // Wait for the snapshot to be installed
+        }
+        if (!heartbeat && peer.nextIndex <= snapshotIndex_) {
+            RaftMessage message = makeMessage(RaftMessage::Type::InstallSnapshot, peer.id);
+            message.index = snapshot_(message.snapshot);
+            message.logTerm = termAt(message.index);
+            message.sentAt = nowNanos();
+            peer.snapshotSent = true;
+            peer.snapshotSentAt = Clock::now();
+            network_->send(std::move(message));
+            return;
+        }
+        RaftMessage message = makeMessage(RaftMessage::Type::AppendEntries, peer.id);
+        message.commit = commitIndex_;
+        message.sentAt = nowNanos();
+        uint64_t first = heartbeat ? peer.matchIndex + 1 : peer.nextIndex;
+        message.index = std::max(first - 1, snapshotIndex_);
+        message.logTerm = termAt(message.index);
+        if (!heartbeat) {
+            uint64_t last = std::min(lastIndex(), message.index + maxBatchEntries_);
+            for (uint64_t index = message.index + 1; index <= last; ++index) {
+                message.entries.push_back(log_[index - snapshotIndex_ - 1]);
+            }
+            peer.nextIndex = last + 1;  // Optimistic: the next batch does not wait for this one
+            peer.inflight += message.entries.empty() ? 0 : 1;
+        }
+        network_->send(std::move(message));
+    }
+
+    void startElection() {
+        ++term_;
+        role_ = RaftStatus::Role::Candidate;
+        votedFor_ = id_;
+        votes_ = 1;
+        leader_ = -1;
+        saveState();
+        resetElectionDeadline();
+        changed_.notify_all();
+        for (const Peer& peer : peers_) {
+            RaftMessage message = makeMessage(RaftMessage::Type::RequestVote, peer.id);
+            message.index = lastIndex();
+            message.logTerm = termAt(lastIndex());
+            network_->send(std::move(message));
+        }
+    }
+
+    // Timer thread: heartbeats and check-quorum on the leader, elections elsewhere
+    void runTimers() {
+        NumaTopology::instance().pinCurrentThread(numaNode_);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            Clock::time_point now = Clock::now();
+            if (role_ == RaftStatus::Role::Leader) {
+                if (now >= nextHeartbeat_) {
+                    size_t reachable = 1;
+                    for (Peer& peer : peers_) {
+                        reachable += now - peer.lastContact < electionTimeout_ ? 1 : 0;
+                        if (peer.matchIndex < lastIndex() && peer.matchIndex == peer.matchAtHeartbeat) {
+                            peer.nextIndex = peer.matchIndex + 1;  // No progress for a whole interval: resend
+                            peer.inflight = 0;
+                        }
+                        peer.matchAtHeartbeat = peer.matchIndex;
+                        sendAppend(peer, peer.inflight > 0 || peer.nextIndex > lastIndex());
+                    }
+                    if (reachable < majority()) {
+                        stepDown(term_);  // Cut off from the majority: stop accepting writes
+                        leader_ = -1;
+                        resetElectionDeadline();
+                    }
+                    nextHeartbeat_ = now + heartbeatInterval_;
+                }
+                tick_.wait_until(lock, nextHeartbeat_);
+            } else {
+                if (now >= electionDeadline_) {
+                    startElection();
+                    if (peers_.empty()) {
+                        becomeLeader(lock);
+                    }
+                }
+                tick_.wait_until(lock, electionDeadline_);
+            }
+        }
+    }
+
+    // Applier thread: installs snapshots and applies committed entries, outside the node lock
+    void runApplier() {
+        NumaTopology::instance().pinCurrentThread(numaNode_);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            work_.wait(lock, [&] { return stopping_ || pendingSnapshot_ || lastApplied_ < commitIndex_; });
+            if (stopping_) {
+                return;
+            }
+            if (pendingSnapshot_) {
+                std::unique_ptr<RaftMessage> message = std::move(pendingSnapshot_);
+                lock.unlock();
+                restore_(message->index, message->snapshot);  // Saves the snapshot durably
+                lock.lock();
+                waitForFlush(lock);
+                installSnapshot(*message);
+                continue;
+            }
+            uint64_t last = std::min(commitIndex_, lastApplied_ + maxBatchEntries_);
+            std::string records;
+            for (uint64_t index = lastApplied_ + 1; index <= last; ++index) {
+                records += log_[index - snapshotIndex_ - 1].record;
+            }
+            lock.unlock();
+            apply_(last, records);
+            lock.lock();
+            lastApplied_ = last;
+            changed_.notify_all();
+        }
+    }
+
+    // Replace the log covered by a restored snapshot and acknowledge it
+    void installSnapshot(const RaftMessage& message) {
+        if (message.index > snapshotIndex_) {
+            if (message.index <= lastIndex() && termAt(message.index) == message.logTerm) {
+                log_.erase(log_.begin(), log_.begin() + static_cast<std::ptrdiff_t>(message.index - snapshotIndex_));
+            } else {
+                log_.clear();
+            }
+            snapshotIndex_ = message.index;
+            snapshotTerm_ = message.logTerm;
+            saveState();
+            rewriteLog();
+        }
+        commitIndex_ = std::max(commitIndex_, message.index);
+        lastApplied_ = std::max(lastApplied_, message.index);
+        changed_.notify_all();
+        RaftMessage reply = makeMessage(RaftMessage::Type::SnapshotResult, message.from);
+        reply.index = message.index;
+        reply.success = true;
+        network_->send(std::move(reply));
+    }
+
+    // Persistence
+
+    void loadState() {
+        std::ifstream stateFile(stateFileName_);
+        stateFile >> term_ >> votedFor_ >> snapshotIndex_ >> snapshotTerm_;
+        if (!stateFile) {
+            term_ = snapshotIndex_ = snapshotTerm_ = 0;
+            votedFor_ = -1;
+        }
+    }
+
+    void saveState() {
+        std::string tmpName = stateFileName_ + ".tmp";
+        {
+            std::ofstream stateFile(tmpName, std::ios::trunc);
+            stateFile << term_ << " " << votedFor_ << " " << snapshotIndex_ << " " << snapshotTerm_ << "\n";
+        }
+        syncFile(tmpName);
+        std::filesystem::rename(tmpName, stateFileName_);
+    }
+
+    // Read the entries after the snapshot; a torn last entry ends the log
+    void loadLog() {
+        std::ifstream logFile(logFileName_, std::ios::binary);
+        uint64_t index = 0, term = 0;
+        size_t size = 0;
+        while (logFile >> index >> term >> size && logFile.get() == '\n') {
+            std::string record(size, '\0');
+            if (!logFile.read(record.data(), static_cast<std::streamsize>(size))) {
+                break;
+            }
+            if (index == lastIndex() + 1) {
+                log_.push_back(RaftEntry{term, std::move(record)});
+            }
+        }
+        durableIndex_ = lastIndex();
+    }
+
+    // Encode entries first to last as "index term size\n" followed by the records
+    std::string encode(uint64_t first, uint64_t last) const {
+        std::string buffer;
+        for (uint64_t index = first; index <= last; ++index) {
+            const RaftEntry& entry = log_[index - snapshotIndex_ - 1];
+            buffer += std::to_string(index) + " " + std::to_string(entry.term) + " " + std::to_string(entry.record.size()) + "\n";
+            buffer += entry.record;
+        }
+        return buffer;
+    }
+
+    // Append encoded entries to the log file, durably if syncLog is set
+    bool writeLog(const std::string& buffer) const {
+        int fd = ::open(logFileName_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        bool written = ::write(fd, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size()) &&
+                       (!syncLog_ || ::fdatasync(fd) == 0);
+        ::close(fd);
+        return written;
+    }
+
+    // Append the entries not yet in the log file with one write
+    void appendLog() {
+        if (!writeLog(encode(durableIndex_ + 1, lastIndex()))) {
+            throw std::runtime_error("Cannot write Raft log " + logFileName_);
+        }
+        durableIndex_ = lastIndex();
+        ++logFlushes_;
+    }
+
+    // Replace the log file with the entries in memory (after truncation or compaction)
+    void rewriteLog() {
+        std::string buffer = encode(snapshotIndex_ + 1, lastIndex());
+        std::string tmpName = logFileName_ + ".tmp";
+        {
+            std::ofstream logFile(tmpName, std::ios::binary | std::ios::trunc);
+            logFile.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+        syncFile(tmpName);
+        std::filesystem::rename(tmpName, logFileName_);
+        durableIndex_ = lastIndex();
+        ++logFlushes_;
+    }
+
+    void syncFile(const std::string& fileName) const {
+        if (!syncLog_) {
+            return;
+        }
+        int fd = ::open(fileName.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fdatasync(fd);
+            ::close(fd);
+        }
+    }
+
+    int id_;
+    SimulatedNetwork* network_;
+    std::chrono::milliseconds electionTimeout_;
+    std::chrono::milliseconds heartbeatInterval_;
+    size_t maxBatchEntries_;
+    size_t maxInflight_;
+    bool syncLog_;
+    std::string logFileName_;
+    std::string stateFileName_;
+    ApplyFunction apply_;
+    SnapshotFunction snapshot_;
+    RestoreFunction restore_;
+    int numaNode_;  // Node whose CPUs run the threads, -1 for any
+
+    // Persistent state
+    uint64_t term_ = 0;
+    int votedFor_ = -1;
+    std::deque<RaftEntry> log_;          // Entries snapshotIndex_ + 1 to lastIndex()
+    uint64_t snapshotIndex_ = 0;
+    uint64_t snapshotTerm_ = 0;
+    uint64_t durableIndex_ = 0;          // Last entry in the log file
+    bool flushing_ = false;              // A flush is writing the log file without the lock
+
+    // Volatile state
+    RaftStatus::Role role_ = RaftStatus::Role::Follower;
+    int leader_ = -1;
+    uint64_t commitIndex_ = 0;
+    uint64_t lastApplied_ = 0;
+    uint64_t termStartIndex_ = std::numeric_limits<uint64_t>::max();  // The no-op of this leader's term
+    size_t votes_ = 0;
+    std::vector<Peer> peers_;
+    std::unique_ptr<RaftMessage> pendingSnapshot_;
+    Clock::time_point electionDeadline_{};
+    Clock::time_point lastHeardLeader_{};
+    Clock::time_point nextHeartbeat_{};
+    uint64_t logFlushes_ = 0;
+    uint64_t leaseReads_ = 0;
+    uint64_t readIndexReads_ = 0;
+    std::mt19937_64 random_{std::random_device{}()};
+    bool stopping_ = false;
+
+    mutable std::mutex mutex_;
+    std::condition_variable tick_;       // Wakes the timer thread
+    std::condition_variable work_;       // Wakes the applier thread
+    std::condition_variable changed_;    // Role, commit, apply or acknowledgement progress
+    std::thread ticker_;
+    std::thread applier_;
+};
+
+// Key Watch Module: Long polling on keys. A watched key has a version, drawn from one sequence every
+// time the key changes, and a list of waiting watchers. Both live in a bucket chosen by the key's hash,
+// so a write locks one bucket and completes only the watchers of its own key. Writes skip the lookup
+// entirely while no key is watched. Watched keys keep their version for the lifetime of the table.
+// The sequence starts at the wall-clock time in nanoseconds, so versions keep increasing across
+// restarts of a process (unless the clock is set back); they are not comparable between replicas.
+struct WatchEvent {
+    bool changed = false;  // False if the wait timed out
+    uint64_t version = 0;  // Version of the key, to pass to the next watch
+    std::string value;     // Value after the change, as get() returns it
+};
+
+class KeyWatchers {
+public:
+    struct Registration {
+        uint64_t id;
+        std::future<WatchEvent> event;
+    };
+
+    // Wait for key to move past sinceVersion. Completes at once if it already has (always for 0),
+    // otherwise on its next change. value() reads the current value; the caller holds the table lock.
+    template <typename ValueFn>
+    Registration add(const std::string& key, uint64_t sinceVersion, ValueFn&& value) {
+        Bucket& bucket = bucketFor(key);
+        std::lock_guard<std::mutex> lock(bucket.mutex);
+        auto it = bucket.keys.find(key);
+        if (it == bucket.keys.end()) {
+            it = bucket.keys.emplace(key, Watched{sequence_.fetch_add(1) + 1, {}}).first;
+            watchedKeys_.fetch_add(1, std::memory_order_relaxed);
+        }
+        Registration registration{nextId_.fetch_add(1), {}};
+        std::promise<WatchEvent> promise;
+        registration.event = promise.get_future();
+        if (it->second.version > sinceVersion) {
+            promise.set_value(WatchEvent{true, it->second.version, value()});
+        } else {
+            it->second.waiters.push_back({registration.id, std::move(promise)});
+        }
+        return registration;
+    }
+
+    // Withdraw a waiting watcher; false if it was already completed
+    bool cancel(const std::string& key, uint64_t id) {
+        Bucket& bucket = bucketFor(key);
+        std::lock_guard<std::mutex> lock(bucket.mutex);
+        auto it = bucket.keys.find(key);
+        if (it == bucket.keys.end()) {
+            return false;
+        }
+        std::vector<Waiter>& waiters = it->second.waiters;
+        for (auto waiter = waiters.begin(); waiter != waiters.end(); ++waiter) {
+            if (waiter->id == id) {
+                waiters.erase(waiter);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Record a change of key; value() is only called if the key is watched
+    template <typename ValueFn>
+    void changed(const std::string& key, ValueFn&& value) {
+        if (watchedKeys_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        Bucket& bucket = bucketFor(key);
+        std::lock_guard<std::mutex> lock(bucket.mutex);
+        auto it = bucket.keys.find(key);
+        if (it != bucket.keys.end()) {
+            complete(it->second, value());
+        }
+    }
+
+    // Record a change of every watched key matching pred, such as a range delete
+    template <typename Predicate, typename ValueFn>
+    void changedWhere(Predicate&& pred, ValueFn&& value) {
+        if (watchedKeys_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        for (Bucket& bucket : buckets_) {
+            std::lock_guard<std::mutex> lock(bucket.mutex);
+            for (auto& pair : bucket.keys) {
+                if (pred(pair.first)) {
+                    complete(pair.second, value(pair.first));
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kBuckets = 64;
+
+    struct Waiter {
+        uint64_t id;
+        std::promise<WatchEvent> promise;
+    };
+
+    struct Watched {
+        uint64_t version;
+        std::vector<Waiter> waiters;
+    };
+
+    struct Bucket {
+        std::mutex mutex;
+        std::unordered_map<std::string, Watched> keys;
+    };
+
+    Bucket& bucketFor(const std::string& key) { return buckets_[std::hash<std::string>()(key) % kBuckets]; }
+
+    void complete(Watched& watched, const std::string& value) {
+        watched.version = sequence_.fetch_add(1) + 1;
+        for (Waiter& waiter : watched.waiters) {
+            waiter.promise.set_value(WatchEvent{true, watched.version, value});
+        }
+        watched.waiters.clear();
+    }
+
+    std::array<Bucket, kBuckets> buckets_;
+    std::atomic<uint64_t> sequence_{static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count())};
+    std::atomic<uint64_t> nextId_{1};
+    std::atomic<size_t> watchedKeys_{0};
+};
+
+// Procedure Module: The view of the table a registered procedure runs against. Reads see the table
+// plus the procedure's own writes; writes are buffered and turned into one batch of WAL records, so
+// the database can log and apply them together once the procedure returns, or drop them if it throws.
+class ProcedureContext {
+public:
+    ProcedureContext(const std::unordered_map<std::string, std::string>& db, const BlobStore& blobs,
+                     const RangeTombstones& tombstones)
+        : db_(db), blobs_(blobs), tombstones_(tombstones) {}
+
+    // Retrieve the value associated with a key, including writes made earlier in this procedure
+    std::string get(const std::string& key) const {
+        auto written = writes_.find(key);
+        if (written != writes_.end()) {
+            return written->second.second ? written->second.first : "Key not found";
+        }
+        if (tombstones_.hidden(key)) {
+            return "Key not found";
+        }
+        auto it = db_.find(key);
+        const std::string* found = it != db_.end() ? &it->second : blobs_.find(key);
+        return found != nullptr ? *found : "Key not found";
+    }
+
+    // Insert or update a key-value pair when the procedure commits
+    void put(const std::string& key, const std::string& value) { writes_[key] = {value, true}; }
+
+    // Remove a key-value pair when the procedure commits
+    void remove(const std::string& key) { writes_[key] = {std::string(), false}; }
+
+    // Keys written by the procedure
+    std::vector<std::string> writtenKeys() const {
+        std::vector<std::string> keys;
+        for (const auto& pair : writes_) {
+            keys.push_back(pair.first);
+        }
+        return keys;
+    }
+
+    // The procedure's writes as WAL records, last write per key, in key order
+    std::string records() const {
+        std::string batch;
+        for (const auto& pair : writes_) {
+            batch += pair.second.second ? WAL::writeRecord(pair.first, pair.second.first) : WAL::deleteRecord(pair.first);
+        }
+        return batch;
+    }
+
+private:
+    const std::unordered_map<std::string, std::string>& db_;
+    const BlobStore& blobs_;
+    const RangeTombstones& tombstones_;
+    std::map<std::string, std::pair<std::string, bool>> writes_;  // Key -> (value, present)
+};
+
+// Server-side procedure: runs against a ProcedureContext with its call arguments, returns a result
+using Procedure = std::function<std::string(ProcedureContext&, const std::vector<std::string>&)>;
+
+// Handover Module: Passes open file descriptors, plus a short description, from one process to
+// another over a Unix domain socket (SCM_RIGHTS), so a new binary can take over without a reload
+class Handover {
+public:
+    static constexpr size_t kMaxFds = 8;
+
+    // Connect to a receiver waiting on socketPath and send the descriptors; they stay open here
+    static bool send(const std::string& socketPath, const std::vector<int>& fds, const std::string& metadata) {
+        if (fds.empty() || fds.size() > kMaxFds || metadata.empty() || metadata.size() > kMaxMetadata) {
+            return false;
+        }
+        int sock = UnixSocket::connectTo(socketPath);
+        if (sock < 0) {
+            return false;
+        }
+        bool sent = false;
+        {
+            alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxFds)] = {};
+            iovec data{const_cast<char*>(metadata.data()), metadata.size()};
+            msghdr message{};
+            message.msg_iov = &data;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+            std::memcpy(CMSG_DATA(header), fds.data(), sizeof(int) * fds.size());
+            sent = ::sendmsg(sock, &message, 0) == static_cast<ssize_t>(metadata.size());
+            char ack = 0;
+            sent = sent && ::recv(sock, &ack, 1, 0) == 1;  // The receiver owns the descriptors now
+        }
+        ::close(sock);
+        return sent;
+    }
+
+    // Listen on socketPath until a sender connects or the timeout expires, then receive its
+    // descriptors (the caller owns them) and description
+    static bool receive(const std::string& socketPath, std::chrono::milliseconds timeout, std::vector<int>& fds,
+                        std::string& metadata) {
+        int listener = UnixSocket::listenOn(socketPath);
+        if (listener < 0) {
+            return false;
+        }
+        bool received = false;
+        pollfd waiting{listener, POLLIN, 0};
+        if (::poll(&waiting, 1, static_cast<int>(timeout.count())) == 1) {
+            int sock = ::accept(listener, nullptr, nullptr);
+            if (sock >= 0) {
+                char buffer[kMaxMetadata];
+                alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxFds)] = {};
+                iovec data{buffer, sizeof(buffer)};
+                msghdr message{};
+                message.msg_iov = &data;
+                message.msg_iovlen = 1;
+                message.msg_control = control;
+                message.msg_controllen = sizeof(control);
+                ssize_t size = ::recvmsg(sock, &message, MSG_CMSG_CLOEXEC);
+                cmsghdr* header = CMSG_FIRSTHDR(&message);
+                if (size > 0 && header != nullptr && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+                    fds.resize((header->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+                    std::memcpy(fds.data(), CMSG_DATA(header), sizeof(int) * fds.size());
+                    metadata.assign(buffer, static_cast<size_t>(size));
+                    char ack = 1;
+                    received = ::send(sock, &ack, 1, MSG_NOSIGNAL) == 1;
+                }
+                ::close(sock);
+            }
+        }
+        ::close(listener);
+        ::unlink(socketPath.c_str());
+        return received;
+    }
+
+private:
+    static constexpr size_t kMaxMetadata = 4096;
+};
+
+// Configuration for an ExDB instance
+struct ExDBOptions {
+    AdmissionOptions admission;  // Write backpressure thresholds
+    bool sortedSnapshot = false; // Also write <db>.sst, a sorted snapshot with a learned index, on mergeLogs
+    size_t dedupThreshold = 0;   // Values of at least this many bytes are stored once per content (0 = off)
+    WalOptions wal;              // WAL backend (stream appends or preallocated mapped segments)
+    size_t hotKeySampleRate = 0; // Sample one in this many get/put calls for hot-key detection (0 = off)
+    size_t hotKeyCount = 16;     // Heavy hitters reported by hotKeys()
+    bool hotKeyReplicas = false; // Serve hot keys from per-CPU copies (requires hotKeySampleRate)
+    std::string handoverSocket;  // Take the table over from a running process on this socket (empty = off)
+    std::chrono::milliseconds handoverTimeout{30000};  // How long to wait for that process
+    ReplicationOptions replication;  // Ship the WAL to followers, or follow a leader
+    RaftOptions raft;                // Replicate through Raft; the Raft log replaces the WAL
+    int numaNode = -1;               // Pin the replication and Raft threads to this node's CPUs (-1 = off)
+};
+
+// Core Database Module: Manages data operations, concurrency control, persistence, and logging
+class ExDB {
+public:
+    // Constructor initializes Storage and WAL modules and loads existing data
+    ExDB(const std::string& dbFileName, const std::string& walFileName, const ExDBOptions& options = {})
+        : walFileName_(walFileName), storage_(dbFileName, &ioScheduler_, options.sortedSnapshot),
+          wal_(walFileName, &ioScheduler_, options.wal),
+          admission_(options.admission), dedupThreshold_(options.dedupThreshold) {
+        if (options.hotKeySampleRate > 0) {
+            hotKeys_ = std::make_unique<HotKeyTracker>(options.hotKeySampleRate, options.hotKeyCount);
+            if (options.hotKeyReplicas) {
+                replicas_ = std::make_unique<ReadReplicas>(options.hotKeyCount);
+            }
+        }
+        load(options);
+        if (!options.replication.followers.empty()) {
+            leader_ = std::make_unique<ReplicationLeader>(
+                options.replication, [this](std::string& records) { return replicationSnapshot(records); },
+                options.numaNode);
+            wal_.setLeader(leader_.get());
+        }
+        if (!options.replication.listenSocket.empty()) {
+            follower_ = std::make_unique<ReplicationFollower>(
+                options.replication.listenSocket, walFileName + ".repl",
+                [this](uint64_t lastLsn, const std::string& records) { applyReplicated(lastLsn, records); },
+                [this](uint64_t lastLsn, const std::string& records) { restoreSnapshot(lastLsn, records, followerApplied_); },
+                [this](uint64_t session) { followSession(session); }, options.numaNode);
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            std::tie(followerSession_, followerApplied_) = follower_->position();  // Kept across restarts
+        }
+        if (options.raft.nodeId >= 0) {
+            raft_ = std::make_unique<RaftNode>(
+                options.raft, walFileName + ".raft", walFileName + ".raftstate",
+                [this](uint64_t lastIndex, const std::string& records) { applyCommitted(lastIndex, records); },
+                [this](std::string& records) { return raftSnapshot(records); },
+                [this](uint64_t index, const std::string& records) { restoreSnapshot(index, records, raftApplied_); },
+                options.numaNode);
+            raftApplied_ = raft_->snapshotIndex();  // db.txt holds the state up to the Raft snapshot
+            raft_->start();
+        }
+    }
+
+    // Insert or update a key-value pair. Returns a token for reading the write back from a
+    // replica with get(key, token): the WAL LSN tagged with the session on a replication leader,
+    // the Raft log index in a Raft cluster, 0 otherwise.
+    uint64_t put(const std::string& key, const std::string& value) {
+        recordAccess(key);
+        if (raft_) {
+            return raft_->replicate(WAL::writeRecord(key, value));  // Applied once committed
+        }
+        ReplicatedWrite replicated(*this);                  // Waits for the ack quorum after unlocking
+        admission_.admit(wal_.pendingBytes());              // Apply backpressure before locking
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        reviveKey(key);
+        fields_.erase(key);                                 // A plain value replaces any field map
+        if (dedupThreshold_ > 0 && value.size() >= dedupThreshold_) {
+            std::string hash;
+            BlobStore::AssignResult result = blobs_.assign(key, value, hash);
+            if (result != BlobStore::AssignResult::Collision) {
+                db_.erase(key);
+                if (result == BlobStore::AssignResult::Created) {
+                    wal_.logBlobOperation(hash, value);     // Log the content once per blob
+                }
+                wal_.logReferenceOperation(key, hash);      // Log the reference for persistence
+                watchers_.changed(key, [&] { return value; });
+                return replicated.token();
+            }
+        }
+        blobs_.release(key);
+        db_[key] = value;                                   // Update in-memory database
+        wal_.logWriteOperation(key, value);                 // Log the operation for persistence
+        watchers_.changed(key, [&] { return value; });      // Wake the key's watchers, once logged
+        return replicated.token();
+    }
+
+    // Retrieve the value associated with a key
+    std::string get(const std::string& key) {
+        bool hot = recordAccess(key);
+        std::string value;
+        if (replicas_ && replicas_->lookup(key, value)) {
+            return value;                                   // Served from this CPU's copy, no shared lock
+        }
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        const std::string* found = findVisible(key);
+        if (found == nullptr) {
+            return "Key not found";
+        }
+        if (hot && replicas_) {
+            replicas_->fill(key, *found);                   // Replicate a detected hot key to this CPU
+        }
+        return *found;
+    }
+
+    // Retrieve a value on a replica that has applied at least the write with the given token
+    // (read-your-writes). Waits up to wait for the replica to catch up, then throws
+    // std::runtime_error so the caller can read from the leader instead. Leaders and standalone
+    // instances have applied every token they returned and answer immediately.
+    std::string get(const std::string& key, uint64_t minToken,
+                    std::chrono::milliseconds wait = std::chrono::milliseconds(50)) {
+        if (follower_ || raft_) {
+            std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+            if (!applied_.wait_for(lock, wait, [&] { return tokenApplied(minToken); })) {
+                throw std::runtime_error("Replica has not applied the write of token " + std::to_string(minToken) +
+                                         "; read from the leader");
+            }
+        }
+        return get(key);
+    }
+
+    // Retrieve a value with a linearizable read on the Raft leader: served locally while the
+    // leader lease holds, otherwise after a heartbeat round. Throws std::runtime_error elsewhere.
+    std::string linearizableGet(const std::string& key) {
+        if (raft_) {
+            raft_->readBarrier();
+        }
+        return get(key);
+    }
+
+    // Remove a key-value pair; returns a read-your-writes token like put()
+    uint64_t remove(const std::string& key) {
+        if (raft_) {
+            return raft_->replicate(WAL::deleteRecord(key));
+        }
+        ReplicatedWrite replicated(*this);                  // Waits for the ack quorum after unlocking
+        admission_.admit(wal_.pendingBytes());              // Apply backpressure before locking
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        reviveKey(key);
+        db_.erase(key);                                     // Remove from in-memory database
+        fields_.erase(key);
+        blobs_.release(key);
+        wal_.logDeleteOperation(key);                      // Log the operation for persistence
+        watchers_.changed(key, [] { return std::string("Key not found"); });
+        return replicated.token();
+    }
+
+    // Retrieve up to len bytes of a value starting at offset; only the requested range is copied
+    std::string getRange(const std::string& key, size_t offset, size_t len) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        auto it = db_.find(key);
+        const std::string* value = it != db_.end() ? &it->second : blobs_.find(key);
+        if (value == nullptr || tombstones_.hidden(key)) {
+            return "Key not found";
+        }
+        if (offset >= value->size()) {
+            return "";
+        }
+        return value->substr(offset, len);
+    }
+
+    // Overwrite part of a value in place (creating or zero-padding it as needed); the WAL records
+    // only the modified range, so neither copies nor log bytes scale with the full value size
+    void setRange(const std::string& key, size_t offset, const std::string& bytes) {
+        if (bytes.empty()) {
+            return;
+        }
+        if (raft_) {
+            raft_->replicate(WAL::rangeRecord(key, offset, bytes));
+            return;
+        }
+        ReplicatedWrite replicated(*this);                  // Waits for the ack quorum after unlocking
+        admission_.admit(wal_.pendingBytes());              // Apply backpressure before locking
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        reviveKey(key);
+        if (const std::string* shared = blobs_.find(key)) {
+            db_[key] = *shared;                             // Copy on write: other keys keep the blob
+            blobs_.release(key);
+        }
+        overwriteRange(db_[key], offset, bytes);            // Update the value in place
+        fields_.erase(key);                                 // A plain value replaces any field map
+        wal_.logRangeOperation(key, offset, bytes);         // Log only the modified range
+        watchers_.changed(key, [&] { return visibleValue(key); });
+    }
+
+    // Set one field of a field-map value, replacing any plain value stored under the key.
+    // Only the changed field is updated in memory and logged.
+    void hset(const std::string& key, const std::string& field, const std::string& value) {
+        if (raft_) {
+            raft_->replicate(WAL::fieldWriteRecord(key, field, value));
+            return;
+        }
+        ReplicatedWrite replicated(*this);                  // Waits for the ack quorum after unlocking
+        admission_.admit(wal_.pendingBytes());              // Apply backpressure before locking
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        reviveKey(key);
+        fields_[key][field] = value;                        // Update the single field
+        db_.erase(key);                                     // A field map replaces any plain value
+        blobs_.release(key);
+        wal_.logFieldWriteOperation(key, field, value);     // Log only the changed field
+        watchers_.changed(key, [&] { return visibleValue(key); });
+    }
+
+    // Retrieve one field of a field-map value
+    std::string hget(const std::string& key, const std::string& field) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        auto it = fields_.find(key);
+        if (it != fields_.end() && !tombstones_.hidden(key)) {
+            auto fieldIt = it->second.find(field);
+            if (fieldIt != it->second.end()) {
+                return fieldIt->second;
+            }
+        }
+        return "Key not found";
+    }
+
+    // Remove one field of a field-map value; the key disappears with its last field
+    void hdel(const std::string& key, const std::string& field) {
+        if (raft_) {
+            raft_->replicate(WAL::fieldDeleteRecord(key, field));
+            return;
+        }
+        ReplicatedWrite replicated(*this);                  // Waits for the ack quorum after unlocking
+        admission_.admit(wal_.pendingBytes());              // Apply backpressure before locking
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        reviveKey(key);
+        auto it = fields_.find(key);
+        if (it == fields_.end() || it->second.erase(field) == 0) {
+            return;
+        }
+        if (it->second.empty()) {
+            fields_.erase(it);
+        }
+        wal_.logFieldDeleteOperation(key, field);           // Log the operation for persistence
+        watchers_.changed(key, [&] { return visibleValue(key); });
+    }
+
+    // Retrieve all fields of a field-map value (empty if the key holds no field map)
+    FieldMap hgetall(const std::string& key) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        auto it = fields_.find(key);
+        return it != fields_.end() && !tombstones_.hidden(key) ? it->second : FieldMap();
+    }
+
+    // Delete every key in [begin, end) with a single WAL record. The keys are hidden immediately;
+    // their memory and disk space are reclaimed when they are written again or by mergeLogs.
+    void deleteRange(const std::string& begin, const std::string& end) {
+        if (begin.empty() || !(begin < end)) {
+            return;
+        }
+        if (raft_) {
+            raft_->replicate(WAL::rangeDeleteRecord(begin, end));  // Applied by purging the range
+            return;
+        }
+        ReplicatedWrite replicated(*this);                  // Waits for the ack quorum after unlocking
+        admission_.admit(wal_.pendingBytes());              // Apply backpressure before locking
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        tombstones_.add(begin, end);
+        if (replicas_) {
+            replicas_->invalidateWhere([&](const std::string& key) { return RangeTombstones::inRange(key, begin, end); });
+        }
+        wal_.logRangeDeleteOperation(begin, end);           // One record for the whole range
+        watchers_.changedWhere([&](const std::string& key) { return RangeTombstones::inRange(key, begin, end); },
+                               [](const std::string&) { return std::string("Key not found"); });
+    }
+
+    // Delete every key that starts with prefix, like deleteRange
+    void deletePrefix(const std::string& prefix) {
+        if (prefix.empty()) {
+            return;
+        }
+        if (raft_) {
+            raft_->replicate(WAL::prefixDeleteRecord(prefix));
+            return;
+        }
+        ReplicatedWrite replicated(*this);                  // Waits for the ack quorum after unlocking
+        admission_.admit(wal_.pendingBytes());              // Apply backpressure before locking
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        tombstones_.add(prefix, RangeTombstones::prefixEnd(prefix));
+        if (replicas_) {
+            replicas_->invalidateWhere([&](const std::string& key) { return key.compare(0, prefix.size(), prefix) == 0; });
+        }
+        wal_.logPrefixDeleteOperation(prefix);              // One record for the whole prefix
+        watchers_.changedWhere([&](const std::string& key) { return key.compare(0, prefix.size(), prefix) == 0; },
+                               [](const std::string&) { return std::string("Key not found"); });
+    }
+
+    // Register a procedure that clients can invoke by name with call(), replacing any of that name
+    void registerProcedure(const std::string& name, Procedure procedure) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        procedures_[name] = std::move(procedure);
+    }
+
+    // Run a registered procedure atomically: under the exclusive lock, with all of its writes
+    // logged as one WAL batch. If it throws, none of its writes are applied. The procedure must
+    // only use its context, not this ExDB. Throws std::invalid_argument for an unknown name.
+    std::string call(const std::string& name, const std::vector<std::string>& args) {
+        if (raft_) {
+            throw std::logic_error("Procedures are not supported in Raft mode");
+        }
+        ReplicatedWrite replicated(*this);                  // Waits for the ack quorum after unlocking
+        admission_.admit(wal_.pendingBytes());              // Apply backpressure before locking
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        auto it = procedures_.find(name);
+        if (it == procedures_.end()) {
+            throw std::invalid_argument("Unknown procedure " + name);
+        }
+        ProcedureContext context(db_, blobs_, tombstones_);
+        std::string result = it->second(context, args);
+        std::string records = context.records();
+        if (!records.empty()) {
+            for (const std::string& key : context.writtenKeys()) {
+                reviveKey(key);
+            }
+            wal_.logBatch(records);                         // Log every write of the call at once
+            std::istringstream batch(records);
+            WAL::applyRecords(batch, db_, fields_, blobs_);
+            keysChanged(records);
+        }
+        return result;
+    }
+
+    // Block until key changes after sinceVersion, or until the timeout. Pass 0 to get the current
+    // value and version at once. On timeout the event has changed == false.
+    WatchEvent watch(const std::string& key, uint64_t sinceVersion,
+                     std::chrono::milliseconds timeout = std::chrono::milliseconds(30000)) {
+        KeyWatchers::Registration registration = addWatch(key, sinceVersion);
+        if (registration.event.wait_for(timeout) == std::future_status::ready ||
+            !watchers_.cancel(key, registration.id)) {
+            return registration.event.get();               // Completed, possibly while cancelling
+        }
+        return WatchEvent{false, sinceVersion, std::string()};
+    }
+
+    // Like watch(), without blocking or a timeout: the future completes when key changes after
+    // sinceVersion. Futures still pending when the ExDB is destroyed throw std::future_error.
+    std::future<WatchEvent> watchAsync(const std::string& key, uint64_t sinceVersion) {
+        return addWatch(key, sinceVersion).event;
+    }
+
+    // Write the current table as an mmappable hash snapshot that HashSnapshot can query in place
+    void exportSnapshot(const std::string& snapshotFileName) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        withVisibleTable([&](const std::unordered_map<std::string, std::string>& table) {
+            HashSnapshot::write(snapshotFileName, table);
+        });
+    }
+
+    // Hand the table and the WAL over to a new process that is waiting in its constructor on
+    // socketPath (ExDBOptions::handoverSocket). The table goes over as an image in a memfd, so
+    // nothing is written to disk. On success the WAL is detached here and writes, checkpoints and
+    // shutdown() throw; this process must stop serving. Returns false (and keeps serving) if no process took over.
+    bool handOver(const std::string& socketPath) {
+        std::lock_guard<std::mutex> checkpointLock(checkpointMutex_);  // Nor a checkpoint half-way done
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // No operation may run during the handover
+        wal_.ensureAttached();
+        int imageFd = ::memfd_create("exdb-image", MFD_CLOEXEC);
+        int fieldsFd = ::memfd_create("exdb-fields", MFD_CLOEXEC);
+        int walFd = -1;
+        bool handedOver = false;
+        if (imageFd >= 0 && fieldsFd >= 0) {
+            std::ofstream image("/proc/self/fd/" + std::to_string(imageFd), std::ios::binary);
+            withVisibleTable([&](const std::unordered_map<std::string, std::string>& table) {
+                HashSnapshot::writeTo(image, table);
+            });
+            image.close();
+            std::ofstream fieldFile("/proc/self/fd/" + std::to_string(fieldsFd));
+            for (const auto& pair : fields_) {
+                if (!tombstones_.hidden(pair.first)) {
+                    for (const auto& field : pair.second) {
+                        fieldFile << pair.first << " " << field.first << " " << field.second << "\n";
+                    }
+                }
+            }
+            fieldFile.close();
+            wal_.detach();
+            walFd = ::open(walFileName_.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+            handedOver = walFd >= 0 && image && fieldFile &&
+                         Handover::send(socketPath, {imageFd, fieldsFd, walFd}, "EXDBHANDOVER1 " + walFileName_);
+            if (!handedOver) {
+                wal_.reopen();
+            }
+        }
+        for (int fd : {imageFd, fieldsFd, walFd}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        return handedOver;
+    }
+
+    // Merge the WAL with the main database file and clear the WAL. Only the copy of the table and
+    // the WAL rotation hold the lock; the paced write to disk runs while operations continue.
+    void mergeLogs() {
+        std::lock_guard<std::mutex> checkpointLock(checkpointMutex_);
+        wal_.ensureAttached();  // After a handover, db.txt and the WAL belong to the new process
+        // A clean-shutdown image is stale once writes after it leave the WAL; the directory sync of
+        // the save below makes the removal durable before the WAL is cleared
+        std::error_code ec;
+        std::filesystem::remove(storage_.cleanMarkerFileName(), ec);
+        std::unordered_map<std::string, std::string> snapshot;
+        FieldMapTable fieldSnapshot;
+        BlobStore blobSnapshot;
+        uint64_t raftIndex = 0;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+            if (!tombstones_.empty()) {                         // Reclaim keys hidden by range deletes
+                RangeTombstones::purge(db_, fields_, blobs_,
+                                       [this](const std::string& key) { return tombstones_.hidden(key); });
+                tombstones_.clear();
+            }
+            snapshot = db_;                                     // Copy the current state
+            fieldSnapshot = fields_;
+            blobSnapshot = blobs_;                              // Shares the blob contents
+            raftIndex = raftApplied_;
+            wal_.rotate();                                      // Later operations go to a fresh WAL
+        }
+        storage_.save(snapshot, fieldSnapshot, blobSnapshot);   // Save the copied state to disk
+        wal_.clearLog();                                        // Clear the merged WAL segment
+        if (raft_) {
+            raft_->compact(raftIndex);                          // The saved state is the Raft snapshot
+        }
+    }
+
+    // Clean shutdown for planned restarts: a final checkpoint, then a memory image of the table and a
+    // marker holding the image's size and CRC-32, so the next start maps the image and skips WAL
+    // replay. Both files are synced before the marker is renamed into place. No operations may follow.
+    void shutdown() {
+        mergeLogs();
+        std::lock_guard<std::mutex> checkpointLock(checkpointMutex_);
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        if (wal_.pendingBytes() != 0 || !tombstones_.empty()) {
+            return;  // A write slipped in after the checkpoint; the next start replays the WAL
+        }
+        HashSnapshot::write(storage_.cleanImageFileName(), db_);
+        uint64_t imageSize = 0;
+        uint32_t imageCrc = 0;
+        if (!fileChecksum(storage_.cleanImageFileName(), imageSize, imageCrc)) {
+            throw std::runtime_error("Cannot read " + storage_.cleanImageFileName());
+        }
+        std::string markerTmp = storage_.cleanMarkerFileName() + ".tmp";
+        std::ofstream marker(markerTmp, std::ios::trunc);
+        marker << "EXDBCLEAN2 " << imageSize << " " << imageCrc << "\n";
+        marker.close();
+        if (!marker) {
+            throw std::runtime_error("Cannot write " + markerTmp);
+        }
+        renameDurably(markerTmp, storage_.cleanMarkerFileName());
+    }
+
+    // Scheduler shared by all disk I/O of this database (checkpoints, WAL, backups)
+    IOScheduler& ioScheduler() { return ioScheduler_; }
+
+    // Write stall metrics from admission control
+    AdmissionController::Stats admissionStats() { return admission_.stats(); }
+
+    // Raft role and progress of this node (default values if Raft is off)
+    RaftStatus raftStatus() const { return raft_ ? raft_->status() : RaftStatus(); }
+
+    // Replication progress: records shipped by a leader or applied by a follower
+    ReplicationStats replicationStats() const {
+        return leader_ ? leader_->stats() : follower_ ? follower_->stats() : ReplicationStats();
+    }
+
+    // Most frequently accessed keys, hottest first (empty unless hotKeySampleRate is set)
+    std::vector<HotKeyTracker::HotKey> hotKeys() const {
+        return hotKeys_ ? hotKeys_->top() : std::vector<HotKeyTracker::HotKey>();
+    }
+
+    // Memory accounting of deduplicated values
+    BlobStore::Stats dedupStats() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        return blobs_.stats();
+    }
+
+private:
+    // Rejects writes on a follower. On a leader with an ack quorum, waits for the quorum to
+    // acknowledge the write's records when it goes out of scope, so declare it before the lock:
+    // the wait then happens after the lock is released, and concurrent writes share a batch.
+    class ReplicatedWrite {
+    public:
+        explicit ReplicatedWrite(const ExDB& db)
+            : leader_(db.leader_.get()), shipped_(ReplicationLeader::lastShippedByThisThread()) {
+            if (db.follower_) {
+                throw std::logic_error("This ExDB follows a replication leader; write to the leader");
+            }
+        }
+
+        ~ReplicatedWrite() {
+            uint64_t lsn = ReplicationLeader::lastShippedByThisThread();
+            if (leader_ != nullptr && lsn != shipped_) {
+                leader_->awaitQuorum(lsn);
+            }
+        }
+
+        // Token of the write: the LSN of its last record, or 0 without a replication leader
+        uint64_t token() const {
+            return leader_ != nullptr ? leader_->tokenFor(ReplicationLeader::lastShippedByThisThread()) : 0;
+        }
+
+        ReplicatedWrite(const ReplicatedWrite&) = delete;
+        ReplicatedWrite& operator=(const ReplicatedWrite&) = delete;
+
+    private:
+        ReplicationLeader* leader_;
+        uint64_t shipped_;  // Last LSN this thread shipped before the write
+    };
+
+    // Load the table: from a handover, the clean-shutdown image, or db.txt plus the WAL
+    void load(const ExDBOptions& options) {
+        if (!options.handoverSocket.empty() && takeOver(options.handoverSocket, options.handoverTimeout)) {
+            return;  // Serving the table handed over by the previous process
+        }
+        // Load persisted data from disk
+        fields_ = storage_.loadFieldMaps();
+        blobs_ = storage_.loadBlobs();
+        if (loadCleanImage()) {
+            return;  // Clean shutdown: the table comes from the mmapped image and the WAL is empty
+        }
+        db_ = storage_.load();
+        // Apply any pending operations from the WAL
+        wal_.applyLog(db_, fields_, blobs_);
+    }
+
+    // Append a batch from the replication leader to our WAL, durably, and apply it to the table
+    void applyReplicated(uint64_t lastLsn, const std::string& records) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        wal_.appendReplicated(records);
+        std::istringstream batch(records);
+        WAL::applyRecords(batch, db_, fields_, blobs_);
+        followerApplied_ = lastLsn;
+        applied_.notify_all();
+        keysChanged(records);
+    }
+
+    // Apply committed Raft entries; the Raft log is this node's WAL
+    void applyCommitted(uint64_t lastIndex, const std::string& records) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        std::istringstream batch(records);
+        WAL::applyRecords(batch, db_, fields_, blobs_);
+        raftApplied_ = lastIndex;
+        applied_.notify_all();
+        keysChanged(records);
+    }
+
+    // Write the table as records for a follower that needs the compacted part of the Raft log
+    uint64_t raftSnapshot(std::string& records) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        tableRecords(records);
+        return raftApplied_;
+    }
+
+    // Write the table as records for a replication follower that missed records no longer in the
+    // leader's backlog; the shared lock keeps writes, and so new LSNs, out meanwhile
+    uint64_t replicationSnapshot(std::string& records) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
+        tableRecords(records);
+        return leader_->lastLsn();
+    }
+
+    // The visible table as records, deduplicated values as BLOB and PUTREF records so that later
+    // references to them resolve. The caller holds a lock.
+    void tableRecords(std::string& records) const {
+        std::unordered_set<std::string> blobsWritten;
+        for (const auto& pair : db_) {
+            if (!tombstones_.hidden(pair.first)) {
+                records += WAL::writeRecord(pair.first, pair.second);
+            }
+        }
+        for (const auto& pair : blobs_.refs()) {
+            if (!tombstones_.hidden(pair.first)) {
+                if (blobsWritten.insert(pair.second).second) {
+                    records += WAL::blobRecord(pair.second, *blobs_.find(pair.first));
+                }
+                records += WAL::referenceRecord(pair.first, pair.second);
+            }
+        }
+        for (const auto& pair : fields_) {
+            for (const auto& field : pair.second) {
+                records += WAL::fieldWriteRecord(pair.first, field.first, field.second);
+            }
+        }
+    }
+
+    // Replace the table with a leader's copy of the data and save it as the checkpoint, before the
+    // Raft log drops its entries. A replication follower also starts a fresh WAL, since the records
+    // in its WAL predate the copy.
+    void restoreSnapshot(uint64_t position, const std::string& records, uint64_t& appliedPosition) {
+        std::lock_guard<std::mutex> checkpointLock(checkpointMutex_);
+        std::unordered_map<std::string, std::string> snapshot;
+        FieldMapTable fieldSnapshot;
+        BlobStore blobSnapshot;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+            db_.clear();
+            fields_.clear();
+            blobs_ = BlobStore();
+            tombstones_.clear();
+            std::istringstream batch(records);
+            WAL::applyRecords(batch, db_, fields_, blobs_);
+            appliedPosition = position;
+            applied_.notify_all();
+            watchers_.changedWhere([](const std::string&) { return true; },
+                                   [&](const std::string& key) { return visibleValue(key); });
+            if (replicas_) {
+                replicas_->clear();
+            }
+            snapshot = db_;
+            fieldSnapshot = fields_;
+            blobSnapshot = blobs_;
+            if (!raft_) {
+                wal_.rotate();
+            }
+        }
+        storage_.save(snapshot, fieldSnapshot, blobSnapshot);
+        if (!raft_) {
+            wal_.clearLog();
+        }
+    }
+
+    KeyWatchers::Registration addWatch(const std::string& key, uint64_t sinceVersion) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);  // Writes cannot change the key meanwhile
+        return watchers_.add(key, sinceVersion, [&] { return visibleValue(key); });
+    }
+
+    // Value of a key as readers see it, or nullptr. The caller holds a lock.
+    const std::string* findVisible(const std::string& key) const {
+        if (tombstones_.hidden(key)) {
+            return nullptr;
+        }
+        auto it = db_.find(key);
+        return it != db_.end() ? &it->second : blobs_.find(key);
+    }
+
+    std::string visibleValue(const std::string& key) const {
+        const std::string* found = findVisible(key);
+        return found != nullptr ? *found : "Key not found";
+    }
+
+    // Drop the per-CPU copies and wake the watchers of every key written by a batch of WAL records
+    // that was just applied; the caller holds the exclusive lock, so no copy is refilled meanwhile
+    void keysChanged(const std::string& records) {
+        std::istringstream batch(records);
+        std::string line, operation, key, end;
+        while (std::getline(batch, line)) {
+            std::istringstream record(line);
+            if (!(record >> operation >> key) || operation == "BLOB") {
+                continue;  // BLOB records carry a content hash, not a key
+            }
+            if (operation == "DELRANGE" || operation == "DELPREFIX") {
+                end = RangeTombstones::prefixEnd(key);
+                if (operation == "DELRANGE") {
+                    record >> end;
+                }
+                auto inRange = [&](const std::string& candidate) { return RangeTombstones::inRange(candidate, key, end); };
+                if (replicas_) {
+                    replicas_->invalidateWhere(inRange);
+                }
+                watchers_.changedWhere(inRange, [&](const std::string& watched) { return visibleValue(watched); });
+            } else {
+                invalidateReplicas(key);
+                watchers_.changed(key, [&] { return visibleValue(key); });
+            }
+        }
+    }
+
+    // Whether the table has the replicated write of a token. The caller holds a lock.
+    bool tokenApplied(uint64_t token) const {
+        return raft_ ? raftApplied_ >= token
+                     : ReplicationLeader::tokenApplied(followerSession_, followerApplied_, token);
+    }
+
+    // A leader run with a new session connected: LSNs start again from 1
+    void followSession(uint64_t session) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
+        followerSession_ = session;
+        followerApplied_ = 0;
+    }
+
+    // Call visit with the table as readers see it: deduplicated values inline, range-deleted keys
+    // left out. Copies only when there are such values or keys. The caller holds a lock.
+    template <typename Visitor>
+    void withVisibleTable(Visitor&& visit) const {
+        if (blobs_.refs().empty() && tombstones_.empty()) {
+            visit(db_);
+            return;
+        }
+        std::unordered_map<std::string, std::string> full;
+        for (const auto& pair : db_) {
+            if (!tombstones_.hidden(pair.first)) {
+                full.insert(pair);
+            }
+        }
+        for (const auto& pair : blobs_.refs()) {
+            if (!tombstones_.hidden(pair.first)) {
+                full[pair.first] = *blobs_.find(pair.first);
+            }
+        }
+        visit(full);
+    }
+
+    // Receive the table from a process calling handOver; the WAL it passes must be our WAL file
+    bool takeOver(const std::string& socketPath, std::chrono::milliseconds timeout) {
+        std::vector<int> fds;
+        std::string metadata;
+        if (!Handover::receive(socketPath, timeout, fds, metadata)) {
+            return false;
+        }
+        struct stat passed {}, ours {};
+        bool valid = fds.size() == 3 && metadata == "EXDBHANDOVER1 " + walFileName_ && ::fstat(fds[2], &passed) == 0 &&
+                     ::stat(walFileName_.c_str(), &ours) == 0 && passed.st_dev == ours.st_dev && passed.st_ino == ours.st_ino;
+        if (valid) {
+            HashSnapshot image("/proc/self/fd/" + std::to_string(fds[0]));  // Maps the memfd
+            valid = image.valid();
+            db_.reserve(image.size());
+            image.forEach([this](std::string_view key, std::string_view value) { db_.emplace(key, value); });
+            std::ifstream fieldFile("/proc/self/fd/" + std::to_string(fds[1]));
+            std::string key, field, value;
+            while (fieldFile >> key >> field >> value) {
+                fields_[key][field] = value;
+            }
+            wal_.reopen();  // The previous process has stopped appending
+        }
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        if (!valid) {
+            db_.clear();
+            fields_.clear();
+        }
+        return valid;
+    }
+
+    // Load the table from the clean-shutdown image if the marker vouches for it (same size and
+    // CRC-32) and the WAL is empty. The marker is consumed either way, since the table diverges
+    // from the image from now on.
+    bool loadCleanImage() {
+        std::ifstream markerFile(storage_.cleanMarkerFileName());
+        std::string magic;
+        uint64_t imageSize = 0;
+        uint32_t imageCrc = 0;
+        bool marked = static_cast<bool>(markerFile >> magic >> imageSize >> imageCrc) && magic == "EXDBCLEAN2";
+        markerFile.close();
+        std::error_code ec;
+        std::filesystem::remove(storage_.cleanMarkerFileName(), ec);
+        uint64_t size = 0;
+        uint32_t crc = 0;
+        if (!marked || wal_.pendingBytes() != 0 || !fileChecksum(storage_.cleanImageFileName(), size, crc) ||
+            size != imageSize || crc != imageCrc) {
+            return false;
+        }
+        HashSnapshot image(storage_.cleanImageFileName());
+        if (!image.valid()) {
+            return false;
+        }
+        db_.reserve(image.size());
+        image.forEach([this](std::string_view key, std::string_view value) { db_.emplace(key, value); });
+        return true;
+    }
+
+    // Size and CRC-32 of a whole file; false if it cannot be read
+    static bool fileChecksum(const std::string& fileName, uint64_t& size, uint32_t& crc) {
+        std::ifstream file(fileName, std::ios::binary);
+        std::vector<char> buffer(1 << 16);
+        size = 0;
+        crc = 0;
+        while (file) {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            crc = crc32(buffer.data(), static_cast<size_t>(file.gcount()), crc);
+            size += static_cast<uint64_t>(file.gcount());
+        }
+        return file.eof() && !file.bad();
+    }
+
+    // Feed the hot-key sketch; called outside the table lock. Returns whether the key is hot.
+    bool recordAccess(const std::string& key) { return hotKeys_ && hotKeys_->record(key); }
+
+    // Drop per-CPU copies of a key about to change; called under the exclusive lock
+    void invalidateReplicas(const std::string& key) {
+        if (replicas_) {
+            replicas_->invalidate(key);
+        }
+    }
+
+    // Drop replicas of a key about to be written, and purge it if a range tombstone hides it
+    void reviveKey(const std::string& key) {
+        invalidateReplicas(key);
+        if (tombstones_.revive(key)) {
+            db_.erase(key);
+            fields_.erase(key);
+            blobs_.release(key);
+        }
+    }
+
+    std::string walFileName_;                             // Name of the WAL file, passed on handover
+    std::unordered_map<std::string, std::string> db_;    // In-memory database
+    FieldMapTable fields_;                                // Field-map values, disjoint from db_
+    BlobStore blobs_;                                     // Deduplicated large values, disjoint from db_
+    RangeTombstones tombstones_;                          // Range deletes not yet reclaimed
+    IOScheduler ioScheduler_;                             // Prioritizes WAL I/O over background I/O
+    Storage storage_;                                     // Storage module for persistence
+    WAL wal_;                                             // WAL module for logging
+    AdmissionController admission_;                       // Write backpressure on checkpoint debt
+    size_t dedupThreshold_;                               // Minimum size of deduplicated values (0 = off)
+    std::unique_ptr<HotKeyTracker> hotKeys_;              // Hot-key detection, if enabled
+    std::unique_ptr<ReadReplicas> replicas_;              // Per-CPU copies of hot keys, if enabled
+    std::shared_mutex mutex_;                             // Mutex for concurrency control
+    std::mutex checkpointMutex_;                          // Serializes mergeLogs calls
+    std::unordered_map<std::string, Procedure> procedures_;  // Registered procedures by name
+    KeyWatchers watchers_;                                // Versions and waiters of watched keys
+    std::unique_ptr<ReplicationLeader> leader_;           // Ships the WAL to followers, if configured
+    std::unique_ptr<ReplicationFollower> follower_;       // Applies a leader's WAL, if following
+    uint64_t followerSession_ = 0;                        // Leader run followerApplied_ belongs to
+    uint64_t followerApplied_ = 0;                        // Last leader LSN applied, if following
+    uint64_t raftApplied_ = 0;                            // Last Raft entry applied to the table
+    std::condition_variable_any applied_;                 // Signaled when replicated writes are applied
+    std::unique_ptr<RaftNode> raft_;                      // Raft replication, if configured; stopped first
+};
+
+// Page sizes that can back table memory
+enum class HugePages {
+    None,          // Regular 4KB pages
+    Transparent,   // Regular mapping advised for transparent huge pages (madvise)
+    Explicit2MB,   // Reserved 2MB huge pages (MAP_HUGETLB), falling back to Transparent
+    Explicit1GB    // Reserved 1GB huge pages (MAP_HUGETLB), falling back to Transparent
+};
+
+// Page Region Module: Growable anonymous memory mapping, optionally bound to a NUMA node and backed
+// by huge pages. Growth may move the mapping, so users address it by offset; new bytes are zero.
+class PageRegion {
+public:
+    explicit PageRegion(int numaNode = -1, HugePages hugePages = HugePages::None)
+        : numaNode_(numaNode), hugePages_(hugePages) {}
+    ~PageRegion() { unmap(); }
+    PageRegion(const PageRegion&) = delete;
+    PageRegion& operator=(const PageRegion&) = delete;
+
+    [[nodiscard]] char* data() const { return data_; }
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] int numaNode() const { return numaNode_; }
+
+    // Pages actually in use: Explicit* degrades to Transparent when no huge pages are reserved
+    [[nodiscard]] HugePages hugePages() const { return hugePages_; }
+
+    // Replace the contents with size zero bytes
+    void assign(size_t size) {
+        unmap();
+        resize(size);
+    }
+
+    // Grow or shrink to size bytes, keeping the existing contents
+    void resize(size_t size) {
+        if (size <= mapped_) {
+            if (size < size_) {
+                std::memset(data_ + size, 0, size_ - size);  // Keep "new bytes are zero" on regrowth
+            }
+            size_ = size;
+            return;
+        }
+        if ((hugePages_ == HugePages::Explicit2MB || hugePages_ == HugePages::Explicit1GB) && remapHuge(size)) {
+            return;
+        }
+        if (hugePages_ != HugePages::None) {
+            hugePages_ = HugePages::Transparent;
+        }
+        void* mapped;
+        if (data_ == nullptr || hugetlb_) {
+            // hugetlb mappings cannot be remapped into regular pages; copy the contents instead
+            mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapped != MAP_FAILED && data_ != nullptr) {
+                std::memcpy(mapped, data_, size_);
+                munmap(data_, mapped_);
+            }
+        } else {
+            mapped = mremap(data_, mapped_, size, MREMAP_MAYMOVE);
+        }
+        if (mapped == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        hugetlb_ = false;
+        data_ = static_cast<char*>(mapped);
+        size_ = mapped_ = size;
+        if (hugePages_ == HugePages::Transparent) {
+            madvise(data_, mapped_, MADV_HUGEPAGE);
+        }
+        bindToNode();
+    }
+
+private:
+    // Map a larger region of reserved huge pages and move the contents over (hugetlb mappings
+    // cannot be grown in place); returns false if no huge pages are available
+    bool remapHuge(size_t size) {
+        const int shift = hugePages_ == HugePages::Explicit1GB ? 30 : 21;
+        const size_t pageSize = size_t{1} << shift;
+        size_t length = (size + pageSize - 1) / pageSize * pageSize;
+        void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        if (data_ != nullptr) {
+            std::memcpy(mapped, data_, size_);
+            munmap(data_, mapped_);
+        }
+        data_ = static_cast<char*>(mapped);
+        size_ = size;
+        mapped_ = length;
+        hugetlb_ = true;
+        bindToNode();
+        return true;
+    }
+
+    void bindToNode() {
+        if (numaNode_ >= 0) {
+            NumaTopology::instance().bindMemory(data_, mapped_, numaNode_);
+        }
+    }
+
+    void unmap() {
+        if (data_ != nullptr) {
+            munmap(data_, mapped_);
+            data_ = nullptr;
+            size_ = mapped_ = 0;
+            hugetlb_ = false;
+        }
+    }
+
+    char* data_ = nullptr;
+    size_t size_ = 0;      // Bytes in use
+    size_t mapped_ = 0;    // Bytes mapped (rounded up to the huge page size)
+    int numaNode_;         // Node the pages are bound to (-1 = default policy)
+    HugePages hugePages_;  // Requested, then actual, page size
+    bool hugetlb_ = false; // data_ is a hugetlb mapping
+};
+
+// Arena Table Module: Hash table whose buckets, keys and values all live in one relocatable arena.
+// Every link is an offset from the arena start, so a checkpoint is a raw dump of the arena pages
+// and a restart reads them back without parsing a single entry.
+class ArenaTable {
+public:
+    static constexpr uint64_t kPageSize = 4096;
+
+    // The arena can be bound to a NUMA node (-1 = default placement) and backed by huge pages
+    explicit ArenaTable(int numaNode = -1, HugePages hugePages = HugePages::None) : arena_(numaNode, hugePages) {
+        reset();
+    }
+
+    // Page size actually backing the arena
+    HugePages hugePages() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return arena_.hugePages();
+    }
+
+    // Insert or update a key-value pair
+    void put(const std::string& key, const std::string& value) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        uint64_t hash = hashKey(key);
+        uint64_t* link = &bucket(hash);
+        while (*link != 0) {
+            Entry* entry = entryAt(*link);
+            if (entry->hash == hash && keyOf(entry) == key) {
+                if (entry->keySize + value.size() <= entry->capacity) {  // Overwrite in place
+                    std::memcpy(dataOf(entry) + entry->keySize, value.data(), value.size());
+                    entry->valueSize = static_cast<uint32_t>(value.size());
+                    return;
+                }
+                uint64_t old = *link;
+                uint64_t next = entry->next;
+                uint64_t fresh = newEntry(hash, key, value);  // May grow and move the arena
+                link = findLink(hash, old);
+                entryAt(fresh)->next = next;
+                *link = fresh;
+                release(old);
+                return;
+            }
+            link = &entry->next;
+        }
+        uint64_t fresh = newEntry(hash, key, value);
+        uint64_t& head = bucket(hash);
+        entryAt(fresh)->next = head;
+        head = fresh;
+        if (++header()->entryCount > header()->bucketCount) {
+            rehash(header()->bucketCount * 2);
+        }
+    }
+
+    // Retrieve the value associated with a key
+    std::string get(const std::string& key) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        uint64_t hash = hashKey(key);
+        for (uint64_t off = bucket(hash); off != 0; off = entryAt(off)->next) {
+            const Entry* entry = entryAt(off);
+            if (entry->hash == hash && keyOf(entry) == key) {
+                return std::string(dataOf(entry) + entry->keySize, entry->valueSize);
+            }
+        }
+        return "Key not found";
+    }
+
+    // Remove a key-value pair
+    void remove(const std::string& key) {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        uint64_t hash = hashKey(key);
+        for (uint64_t* link = &bucket(hash); *link != 0; link = &entryAt(*link)->next) {
+            Entry* entry = entryAt(*link);
+            if (entry->hash == hash && keyOf(entry) == key) {
+                uint64_t old = *link;
+                *link = entry->next;
+                release(old);
+                --header()->entryCount;
+                return;
+            }
+        }
+    }
+
+    // Number of stored pairs
+    uint64_t size() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return header()->entryCount;
+    }
+
+    // Dump the arena pages sequentially, each protected by its own CRC-32. The file is replaced
+    // durably, so a failed write keeps the previous checkpoint; throws on failure.
+    void checkpoint(const std::string& fileName) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        uint64_t pageCount = arena_.size() / kPageSize;
+        std::vector<uint32_t> checksums(pageCount);
+        for (uint64_t i = 0; i < pageCount; ++i) {
+            checksums[i] = crc32(arena_.data() + i * kPageSize, kPageSize);
+        }
+        std::string tmpName = fileName + ".tmp";
+        std::ofstream imageFile(tmpName, std::ios::binary | std::ios::trunc);
+        uint64_t pageSize = kPageSize;
+        imageFile.write(kMagic, 8);
+        imageFile.write(reinterpret_cast<const char*>(&pageSize), 8);
+        imageFile.write(reinterpret_cast<const char*>(&pageCount), 8);
+        imageFile.write(reinterpret_cast<const char*>(checksums.data()), static_cast<std::streamsize>(pageCount * 4));
+        imageFile.write(arena_.data(), static_cast<std::streamsize>(arena_.size()));
+        imageFile.close();
+        if (!imageFile) {
+            throw std::runtime_error("Cannot write " + tmpName);
+        }
+        renameDurably(tmpName, fileName);
+    }
+
+    // Read a checkpoint back as raw pages; returns false (leaving the table untouched) if the
+    // image is missing, truncated, or any page fails its checksum
+    bool restore(const std::string& fileName) {
+        std::ifstream imageFile(fileName, std::ios::binary);
+        char magic[8];
+        uint64_t pageSize = 0, pageCount = 0;
+        if (!imageFile.read(magic, 8) || std::memcmp(magic, kMagic, 8) != 0 ||
+            !imageFile.read(reinterpret_cast<char*>(&pageSize), 8) || pageSize != kPageSize ||
+            !imageFile.read(reinterpret_cast<char*>(&pageCount), 8) || pageCount == 0) {
+            return false;
+        }
+        std::vector<uint32_t> checksums(pageCount);
+        std::vector<char> pages(pageCount * kPageSize);
+        if (!imageFile.read(reinterpret_cast<char*>(checksums.data()), static_cast<std::streamsize>(pageCount * 4)) ||
+            !imageFile.read(pages.data(), static_cast<std::streamsize>(pages.size()))) {
+            return false;
+        }
+        for (uint64_t i = 0; i < pageCount; ++i) {
+            if (crc32(pages.data() + i * kPageSize, kPageSize) != checksums[i]) {
+                return false;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        arena_.resize(pages.size());
+        std::memcpy(arena_.data(), pages.data(), pages.size());
+        return true;
+    }
+
+private:
+    static constexpr char kMagic[9] = "EXDBIMG1";
+    static constexpr int kSizeClasses = 40;
+
+    // Lives at offset 0 of the arena so that it is checkpointed with everything else
+    struct Header {
+        uint64_t bucketCount;
+        uint64_t buckets;                   // Offset of the bucket array
+        uint64_t entryCount;
+        uint64_t used;                      // Bump-allocation watermark
+        uint64_t freeLists[kSizeClasses];   // Heads of per-size-class free lists
+    };
+
+    struct Entry {
+        uint64_t next;       // Offset of the next entry in the bucket chain
+        uint64_t hash;
+        uint32_t keySize;
+        uint32_t valueSize;
+        uint32_t capacity;   // Bytes available for key + value
+        uint32_t sizeClass;
+    };
+
+    Header* header() { return reinterpret_cast<Header*>(arena_.data()); }
+    Entry* entryAt(uint64_t off) { return reinterpret_cast<Entry*>(arena_.data() + off); }
+    static char* dataOf(Entry* entry) { return reinterpret_cast<char*>(entry + 1); }
+    static const char* dataOf(const Entry* entry) { return reinterpret_cast<const char*>(entry + 1); }
+    static std::string_view keyOf(const Entry* entry) { return std::string_view(dataOf(entry), entry->keySize); }
+    uint64_t& bucket(uint64_t hash) {
+        Header* h = header();
+        return reinterpret_cast<uint64_t*>(arena_.data() + h->buckets)[hash & (h->bucketCount - 1)];
+    }
+
+    uint64_t* findLink(uint64_t hash, uint64_t target) {
+        uint64_t* link = &bucket(hash);
+        while (*link != target) {
+            link = &entryAt(*link)->next;
+        }
+        return link;
+    }
+
+    void reset() {
+        arena_.assign(kPageSize);
+        header()->used = sizeof(Header);
+        uint64_t buckets = allocate(16 * sizeof(uint64_t), nullptr);
+        header()->buckets = buckets;
+        header()->bucketCount = 16;
+    }
+
+    // Allocate from the free list of the matching power-of-two class, else bump-allocate,
+    // growing the arena by whole pages. Offsets stay valid across growth; raw pointers do not.
+    uint64_t allocate(uint64_t size, uint32_t* sizeClassOut) {
+        uint32_t sizeClass = sizeClassFor(size);
+        if (sizeClassOut != nullptr) {
+            *sizeClassOut = sizeClass;
+        }
+        uint64_t off = header()->freeLists[sizeClass];
+        if (off != 0) {
+            std::memcpy(&header()->freeLists[sizeClass], arena_.data() + off, 8);
+            std::memset(arena_.data() + off, 0, uint64_t{1} << sizeClass);
+            return off;
+        }
+        off = header()->used;
+        uint64_t end = off + (uint64_t{1} << sizeClass);
+        if (end > arena_.size()) {
+            uint64_t grown = std::max<uint64_t>(arena_.size() * 2, (end + kPageSize - 1) / kPageSize * kPageSize);
+            arena_.resize(grown);
+        }
+        header()->used = end;
+        return off;
+    }
+
+    static uint32_t sizeClassFor(uint64_t size) {
+        uint32_t sizeClass = 5;  // Smallest block is 32 bytes
+        while ((uint64_t{1} << sizeClass) < size) {
+            ++sizeClass;
+        }
+        return sizeClass;
+    }
+
+    void deallocate(uint64_t off, uint32_t sizeClass) {
+        std::memcpy(arena_.data() + off, &header()->freeLists[sizeClass], 8);
+        header()->freeLists[sizeClass] = off;
+    }
+
+    uint64_t newEntry(uint64_t hash, const std::string& key, const std::string& value) {
+        uint32_t sizeClass;
+        uint64_t off = allocate(sizeof(Entry) + key.size() + value.size(), &sizeClass);
+        Entry* entry = entryAt(off);
+        entry->next = 0;
+        entry->hash = hash;
+        entry->keySize = static_cast<uint32_t>(key.size());
+        entry->valueSize = static_cast<uint32_t>(value.size());
+        entry->capacity = static_cast<uint32_t>((uint64_t{1} << sizeClass) - sizeof(Entry));
+        entry->sizeClass = sizeClass;
+        std::memcpy(dataOf(entry), key.data(), key.size());
+        std::memcpy(dataOf(entry) + key.size(), value.data(), value.size());
+        return off;
+    }
+
+    void release(uint64_t off) { deallocate(off, entryAt(off)->sizeClass); }
+
+    void rehash(uint64_t bucketCount) {
+        uint64_t oldBuckets = header()->buckets;
+        uint64_t oldCount = header()->bucketCount;
+        uint64_t buckets = allocate(bucketCount * sizeof(uint64_t), nullptr);
+        header()->buckets = buckets;
+        header()->bucketCount = bucketCount;
+        for (uint64_t i = 0; i < oldCount; ++i) {
+            uint64_t off;
+            std::memcpy(&off, arena_.data() + oldBuckets + i * 8, 8);
+            while (off != 0) {
+                Entry* entry = entryAt(off);
+                uint64_t next = entry->next;
+                uint64_t& head = bucket(entry->hash);
+                entry->next = head;
+                head = off;
+                off = next;
+            }
+        }
+        deallocate(oldBuckets, sizeClassFor(oldCount * sizeof(uint64_t)));
+    }
+
+    PageRegion arena_;          // Page-granular, relocatable backing memory
+    std::shared_mutex mutex_;   // Mutex for concurrency control
+};
+
+// NUMA Sharded Table Module: Splits a table into ArenaTable shards whose memory is bound to one NUMA
+// node each. Per-node worker threads are pinned to their node and requests are routed to a worker
+// on the home node of the key, so table memory is touched from the local socket. Accesses are
+// counted as local or remote to report cross-socket traffic.
+class NumaShardedTable {
+public:
+    // Access counts by whether the calling CPU was on the shard's node
+    struct Stats {
+        uint64_t localAccesses = 0;
+        uint64_t remoteAccesses = 0;
+    };
+
+    // shardsPerNode shards are placed on each node of the machine
+    explicit NumaShardedTable(size_t shardsPerNode = 1, HugePages hugePages = HugePages::None) {
+        const NumaTopology& topology = NumaTopology::instance();
+        for (int node = 0; node < topology.nodeCount(); ++node) {
+            for (size_t i = 0; i < std::max<size_t>(1, shardsPerNode); ++i) {
+                shards_.push_back(std::make_unique<Shard>(node, hugePages));
+            }
+        }
+    }
+
+    ~NumaShardedTable() { stopWorkers(); }
+
+    // Insert or update a key-value pair
+    void put(const std::string& key, const std::string& value) { shardFor(key).access().put(key, value); }
+
+    // Retrieve the value associated with a key
+    std::string get(const std::string& key) { return shardFor(key).access().get(key); }
+
+    // Remove a key-value pair
+    void remove(const std::string& key) { shardFor(key).access().remove(key); }
+
+    // Node holding the key; requests for it are cheapest on a thread of this node
+    [[nodiscard]] int homeNode(const std::string& key) const {
+        return shards_[std::hash<std::string>{}(key) % shards_.size()]->node;
+    }
+
+    // Start threadsPerNode workers on each node, pinned to the CPUs of that node
+    void startWorkers(size_t threadsPerNode = 1) {
+        stopWorkers();
+        const NumaTopology& topology = NumaTopology::instance();
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        for (int node = 0; node < topology.nodeCount(); ++node) {
+            auto queue = std::make_unique<WorkQueue>();
+            for (size_t i = 0; i < std::max<size_t>(1, threadsPerNode); ++i) {
+                queue->threads.emplace_back([node, q = queue.get()] {
+                    NumaTopology::instance().pinCurrentThread(node);
+                    runWorker(*q);
+                });
+            }
+            queues.push_back(std::move(queue));
+        }
+        std::unique_lock<std::shared_mutex> lock(queuesMutex_);
+        queues_ = std::move(queues);
+    }
+
+    // Stop and join the workers, after running the requests already queued. Requests submitted
+    // from now on run inline.
+    void stopWorkers() {
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+        {
+            std::unique_lock<std::shared_mutex> lock(queuesMutex_);  // Waits for submits in progress
+            queues.swap(queues_);
+        }
+        for (auto& queue : queues) {
+            {
+                std::lock_guard<std::mutex> lock(queue->mutex);
+                queue->stopping = true;
+            }
+            queue->ready.notify_all();
+            for (std::thread& thread : queue->threads) {
+                thread.join();
+            }
+        }
+    }
+
+    // Run a request for key on a worker of the key's home node (inline if no workers are running)
+    std::future<void> submit(const std::string& key, std::function<void(NumaShardedTable&)> request) {
+        std::packaged_task<void()> task([this, request = std::move(request)] { request(*this); });
+        std::future<void> result = task.get_future();
+        std::shared_lock<std::shared_mutex> queuesLock(queuesMutex_);
+        if (queues_.empty()) {
+            queuesLock.unlock();
+            task();
+            return result;
+        }
+        WorkQueue& queue = *queues_[static_cast<size_t>(homeNode(key)) % queues_.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        queue.ready.notify_one();
+        return result;
+    }
+
+    // Local and remote access counts across all shards
+    [[nodiscard]] Stats stats() const {
+        Stats stats;
+        for (const auto& shard : shards_) {
+            stats.localAccesses += shard->localAccesses.load(std::memory_order_relaxed);
+            stats.remoteAccesses += shard->remoteAccesses.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
+private:
+    struct alignas(64) Shard {
+        Shard(int shardNode, HugePages hugePages) : node(shardNode), table(shardNode, hugePages) {}
+
+        // Count the access by the caller's node and hand out the table
+        ArenaTable& access() {
+            bool local = NumaTopology::instance().currentNode() == node;
+            (local ? localAccesses : remoteAccesses).fetch_add(1, std::memory_order_relaxed);
+            return table;
+        }
+
+        int node;
+        ArenaTable table;
+        std::atomic<uint64_t> localAccesses{0};
+        std::atomic<uint64_t> remoteAccesses{0};
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::packaged_task<void()>> tasks;
+        std::vector<std::thread> threads;
+        bool stopping = false;
+    };
+
+    Shard& shardFor(const std::string& key) { return *shards_[std::hash<std::string>{}(key) % shards_.size()]; }
+
+    static void runWorker(WorkQueue& queue) {
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        while (true) {
+            queue.ready.wait(lock, [&queue] { return queue.stopping || !queue.tasks.empty(); });
+            if (queue.tasks.empty()) {
+                return;
+            }
+            std::packaged_task<void()> task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<std::unique_ptr<WorkQueue>> queues_;   // One per node while workers run
+    std::shared_mutex queuesMutex_;                    // Shared by submits, exclusive to start and stop
+};
+
+// Epoch Reclamation Module: Frees memory unlinked from a structure with lock-free readers once no
+// reader can still reach it. A reader holds a Guard for the duration of an operation, which pins
+// the current epoch parity. reclaim() flips the epoch, waits for the readers of the previous
+// parity, and frees everything retired before the flip.
+class EpochReclaimer {
+public:
+    using Deleter = void (*)(void*);
+
+    // Retired items are freed in batches of at least batchSize
+    explicit EpochReclaimer(size_t batchSize = 64) : batchSize_(batchSize) {}
+
+    ~EpochReclaimer() {
+        for (const auto& pair : retired_) {
+            pair.second(pair.first);
+        }
+    }
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    class Guard {
+    public:
+        explicit Guard(const EpochReclaimer& epochs) : epochs_(epochs) {
+            for (;;) {
+                uint64_t epoch = epochs_.epoch_.load();
+                parity_ = epoch & 1;
+                epochs_.readers_[parity_].fetch_add(1);
+                if (epochs_.epoch_.load() == epoch) {
+                    break;
+                }
+                epochs_.readers_[parity_].fetch_sub(1);
+            }
+        }
+        ~Guard() { epochs_.readers_[parity_].fetch_sub(1); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        const EpochReclaimer& epochs_;
+        uint64_t parity_ = 0;
+    };
+
+    // Queue memory that is no longer reachable by new readers, to be freed by deleter later
+    void retire(void* pointer, Deleter deleter) {
+        std::lock_guard<std::mutex> lock(retireMutex_);
+        retired_.emplace_back(pointer, deleter);
+    }
+
+    // Free everything retired so far once the readers that could hold it have finished, if a batch
+    // is waiting and no other thread is already reclaiming; the caller must not hold a Guard
+    void reclaim() {
+        std::unique_lock<std::mutex> reclaimLock(reclaimMutex_, std::try_to_lock);
+        if (!reclaimLock.owns_lock()) {
+            return;
+        }
+        std::vector<std::pair<void*, Deleter>> batch;
+        {
+            std::lock_guard<std::mutex> lock(retireMutex_);
+            if (retired_.size() < batchSize_) {
+                return;
+            }
+            batch.swap(retired_);
+        }
+        uint64_t previous = epoch_.fetch_add(1);
+        while (readers_[previous & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+        for (const auto& pair : batch) {
+            pair.second(pair.first);
+        }
+    }
+
+private:
+    const size_t batchSize_;
+    std::mutex retireMutex_;                          // Protects the retired list
+    std::mutex reclaimMutex_;                         // One reclaimer at a time
+    std::vector<std::pair<void*, Deleter>> retired_;  // Unlinked memory awaiting reclamation
+    mutable std::atomic<uint64_t> epoch_{0};          // Reclamation epoch
+    mutable std::atomic<int64_t> readers_[2]{};       // Active readers per epoch parity
+};
+
+// Adaptive Radix Tree Module: Ordered, memory-efficient index for long keys with shared prefixes.
+// Inner nodes adapt between 4, 16, 48 and 256 children and store compressed paths, and leaves keep
+// only the key bytes below their position, so a shared prefix is stored once instead of per key.
+// Readers use optimistic lock coupling (per-node version validation, no shared writes); writers
+// are serialized, and unlinked nodes are freed once no reader can still reach them.
+class ArtIndex {
+public:
+    ArtIndex() = default;
+
+    ~ArtIndex() { freeTree(root_.load(std::memory_order_relaxed)); }  // epochs_ frees the retired refs
+
+    ArtIndex(const ArtIndex&) = delete;
+    ArtIndex& operator=(const ArtIndex&) = delete;
+
+    // Insert or update a key-value pair
+    void put(const std::string& key, const std::string& value) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::atomic<Ref>* slot = &root_;
+        Node* owner = nullptr;
+        size_t depth = 0;
+        for (;;) {
+            Ref ref = slot->load(std::memory_order_relaxed);
+            if (ref == 0) {
+                publish(slot, owner, makeLeaf(std::string_view(key).substr(depth), value));
+                ++size_;
+                break;
+            }
+            if (isLeaf(ref)) {
+                const Leaf* leaf = asLeaf(ref);
+                if (key.compare(depth, std::string::npos, leaf->suffix()) == 0) {
+                    publish(slot, owner, makeLeaf(leaf->suffix(), value));
+                    retire(ref);
+                    break;
+                }
+                // Lazy expansion ends here: both keys continue below a new node holding their common part
+                size_t common = commonPrefix(leaf->suffix(), 0, key, depth);
+                Node* node = newNode(kNode4, std::string(leaf->suffix().substr(0, common)));
+                placeLeaf(node, leaf->suffix(), common, leaf->value());
+                placeLeaf(node, key, depth + common, value);
+                publish(slot, owner, nodeRef(node));
+                retire(ref);
+                ++size_;
+                break;
+            }
+            Node* node = asNode(ref);
+            size_t common = commonPrefix(node->prefix, 0, key, depth);
+            if (common < node->prefix.size()) {
+                // The key leaves the compressed path: split it with a new node at the mismatch
+                Node* split = newNode(kNode4, node->prefix.substr(0, common));
+                Node* moved = copyNode(node, node->type, node->prefix.substr(common + 1));
+                addChild(split, static_cast<uint8_t>(node->prefix[common]), nodeRef(moved));
+                placeLeaf(split, key, depth + common, value);
+                publish(slot, owner, nodeRef(split));
+                retire(ref);
+                ++size_;
+                break;
+            }
+            depth += common;
+            if (depth == key.size()) {
+                Ref old = node->terminal.load(std::memory_order_relaxed);
+                publish(&node->terminal, node, makeLeaf(std::string_view(), value));
+                if (old != 0) {
+                    retire(old);
+                } else {
+                    ++size_;
+                }
+                break;
+            }
+            uint8_t byte = static_cast<uint8_t>(key[depth]);
+            std::atomic<Ref>* child = findChild(node, byte);
+            if (child != nullptr) {
+                slot = child;
+                owner = node;
+                ++depth;
+                continue;
+            }
+            Ref leaf = makeLeaf(std::string_view(key).substr(depth + 1), value);
+            if (node->count.load(std::memory_order_relaxed) == capacity(node->type)) {
+                Node* grown = copyNode(node, static_cast<NodeType>(node->type + 1), node->prefix);
+                addChild(grown, byte, leaf);
+                publish(slot, owner, nodeRef(grown));
+                retire(ref);
+            } else {
+                writeLock(node);
+                addChild(node, byte, leaf);
+                writeUnlock(node);
+            }
+            ++size_;
+            break;
+        }
+        epochs_.reclaim();
+    }
+
+    // Retrieve the value associated with a key without taking any lock
+    std::string get(const std::string& key) const {
+        EpochReclaimer::Guard guard(epochs_);
+        std::string value;
+        bool found = false;
+        while (!tryGet(key, value, found)) {
+            std::this_thread::yield();  // A writer changed a node on our path; start over
+        }
+        return found ? value : "Key not found";
+    }
+
+    // Remove a key-value pair, shrinking or collapsing nodes that become sparse
+    void remove(const std::string& key) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::atomic<Ref>* slot = &root_;
+        Node* owner = nullptr;
+        std::atomic<Ref>* ownerSlot = nullptr;  // Slot that holds `owner`
+        Node* ownerOwner = nullptr;             // Node that holds `ownerSlot`
+        size_t depth = 0;
+        for (;;) {
+            Ref ref = slot->load(std::memory_order_relaxed);
+            if (ref == 0) {
+                return;
+            }
+            if (isLeaf(ref)) {
+                if (key.compare(depth, std::string::npos, asLeaf(ref)->suffix()) != 0) {
+                    return;
+                }
+                if (owner == nullptr) {
+                    publish(slot, nullptr, 0);
+                } else {
+                    writeLock(owner);
+                    removeChild(owner, static_cast<uint8_t>(key[depth - 1]));
+                    writeUnlock(owner);
+                    compact(owner, ownerSlot, ownerOwner);
+                }
+                retire(ref);
+                break;
+            }
+            Node* node = asNode(ref);
+            if (key.compare(depth, node->prefix.size(), node->prefix) != 0) {
+                return;
+            }
+            depth += node->prefix.size();
+            if (depth == key.size()) {
+                Ref leaf = node->terminal.load(std::memory_order_relaxed);
+                if (leaf == 0) {
+                    return;
+                }
+                publish(&node->terminal, node, 0);
+                retire(leaf);
+                compact(node, slot, owner);
+                break;
+            }
+            std::atomic<Ref>* child = findChild(node, static_cast<uint8_t>(key[depth]));
+            if (child == nullptr) {
+                return;
+            }
+            ownerSlot = slot;
+            ownerOwner = owner;
+            slot = child;
+            owner = node;
+            ++depth;
+        }
+        --size_;
+        epochs_.reclaim();
+    }
+
+    // Number of stored pairs
+    size_t size() const { return size_.load(); }
+
+    // Visit pairs with begin <= key < end in key order (an empty end means no upper bound) as
+    // visit(const std::string& key, std::string_view value); the visitor returns false to stop. Writers are paused for the duration of the scan.
+    template <typename Visitor>
+    void scanRange(const std::string& begin, const std::string& end, Visitor&& visit) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        std::string path;
+        scan(root_.load(std::memory_order_relaxed), path, begin, end, visit);
+    }
+
+    // Visit all pairs whose key starts with prefix, in key order
+    template <typename Visitor>
+    void scanPrefix(const std::string& prefix, Visitor&& visit) {
+        std::string end = prefix;
+        while (!end.empty() && static_cast<uint8_t>(end.back()) == 0xFF) {
+            end.pop_back();
+        }
+        if (!end.empty()) {
+            end.back() = static_cast<char>(static_cast<uint8_t>(end.back()) + 1);
+        }
+        scanRange(prefix, end, visit);
+    }
+
+    // Approximate heap bytes used by nodes, leaves, and their strings
+    size_t memoryUsage() {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        return memoryOf(root_.load(std::memory_order_relaxed));
+    }
+
+private:
+    // A child reference is either a Node* or a Leaf* tagged with the low bit
+    using Ref = uintptr_t;
+
+    enum NodeType : uint8_t { kNode4, kNode16, kNode48, kNode256 };
+
+    // Leaves are single immutable allocations (header, key suffix, value); an update installs a new leaf
+    struct Leaf {
+        uint32_t suffixSize;  // Key bytes below the leaf's position in the tree
+        uint32_t valueSize;
+        std::string_view suffix() const { return std::string_view(reinterpret_cast<const char*>(this + 1), suffixSize); }
+        std::string_view value() const {
+            return std::string_view(reinterpret_cast<const char*>(this + 1) + suffixSize, valueSize);
+        }
+    };
+
+    // Version word: bit 0 = obsolete, bit 1 = locked, higher bits = change counter
+    struct Node {
+        Node(NodeType nodeType, std::string nodePrefix) : type(nodeType), prefix(std::move(nodePrefix)) {}
+        std::atomic<uint64_t> version{0};
+        const NodeType type;
+        std::atomic<uint16_t> count{0};
+        const std::string prefix;          // Compressed path; immutable, a split copies the node
+        std::atomic<Ref> terminal{0};      // Leaf for the key that ends exactly at this node
+    };
+
+    struct Node4 : Node {
+        using Node::Node;
+        std::atomic<uint8_t> keys[4]{};
+        std::atomic<Ref> children[4]{};
+    };
+
+    struct Node16 : Node {
+        using Node::Node;
+        std::atomic<uint8_t> keys[16]{};
+        std::atomic<Ref> children[16]{};
+    };
+
+    struct Node48 : Node {
+        using Node::Node;
+        std::atomic<uint8_t> childIndex[256]{};  // 0 = empty, otherwise child slot + 1
+        std::atomic<Ref> children[48]{};
+    };
+
+    struct Node256 : Node {
+        using Node::Node;
+        std::atomic<Ref> children[256]{};
+    };
+
+    static bool isLeaf(Ref ref) { return (ref & 1) != 0; }
+    static Leaf* asLeaf(Ref ref) { return reinterpret_cast<Leaf*>(ref & ~Ref{1}); }
+    static Node* asNode(Ref ref) { return reinterpret_cast<Node*>(ref); }
+    static Ref nodeRef(Node* node) { return reinterpret_cast<Ref>(node); }
+    static Ref makeLeaf(std::string_view suffix, std::string_view value) {
+        void* memory = ::operator new(sizeof(Leaf) + suffix.size() + value.size());
+        Leaf* leaf = new (memory) Leaf{static_cast<uint32_t>(suffix.size()), static_cast<uint32_t>(value.size())};
+        if (!suffix.empty()) {
+            std::memcpy(leaf + 1, suffix.data(), suffix.size());
+        }
+        if (!value.empty()) {
+            std::memcpy(reinterpret_cast<char*>(leaf + 1) + suffix.size(), value.data(), value.size());
+        }
+        return reinterpret_cast<Ref>(leaf) | 1;
+    }
+
+    static uint16_t capacity(NodeType type) {
+        static const uint16_t capacities[] = {4, 16, 48, 256};
+        return capacities[type];
+    }
+
+    static size_t commonPrefix(std::string_view a, size_t aPos, std::string_view b, size_t bPos) {
+        size_t n = 0;
+        while (aPos + n < a.size() && bPos + n < b.size() && a[aPos + n] == b[bPos + n]) {
+            ++n;
+        }
+        return n;
+    }
+
+    static Node* newNode(NodeType type, std::string prefix) {
+        switch (type) {
+            case kNode4: return new Node4(type, std::move(prefix));
+            case kNode16: return new Node16(type, std::move(prefix));
+            case kNode48: return new Node48(type, std::move(prefix));
+            default: return new Node256(type, std::move(prefix));
+        }
+    }
+
+    // Seqlock-style writer protocol: readers that overlap a locked section fail validation
+    static void writeLock(Node* node) {
+        node->version.fetch_add(2, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    static void writeUnlock(Node* node) { node->version.fetch_add(2, std::memory_order_release); }
+
+    static bool readLock(const Node* node, uint64_t& version) {
+        version = node->version.load(std::memory_order_acquire);
+        return (version & 3) == 0;
+    }
+    static bool validate(const Node* node, uint64_t version) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return node->version.load(std::memory_order_relaxed) == version;
+    }
+
+    // Store a child reference, locking the node that owns the slot (the root slot has no owner)
+    static void publish(std::atomic<Ref>* slot, Node* owner, Ref ref) {
+        if (owner != nullptr) {
+            writeLock(owner);
+        }
+        slot->store(ref, std::memory_order_release);
+        if (owner != nullptr) {
+            writeUnlock(owner);
+        }
+    }
+
+    static std::atomic<Ref>* findChild(Node* node, uint8_t byte) {
+        return const_cast<std::atomic<Ref>*>(findChild(static_cast<const Node*>(node), byte));
+    }
+
+    static const std::atomic<Ref>* findChild(const Node* node, uint8_t byte) {
+        switch (node->type) {
+            case kNode4: {
+                auto* n = static_cast<const Node4*>(node);
+                uint16_t count = std::min<uint16_t>(n->count.load(std::memory_order_relaxed), 4);
+                for (uint16_t i = 0; i < count; ++i) {
+                    if (n->keys[i].load(std::memory_order_relaxed) == byte) {
+                        return &n->children[i];
+                    }
+                }
+                return nullptr;
+            }
+            case kNode16: {
+                auto* n = static_cast<const Node16*>(node);
+                uint16_t count = std::min<uint16_t>(n->count.load(std::memory_order_relaxed), 16);
+                for (uint16_t i = 0; i < count; ++i) {
+                    if (n->keys[i].load(std::memory_order_relaxed) == byte) {
+                        return &n->children[i];
+                    }
+                }
+                return nullptr;
+            }
+            case kNode48: {
+                auto* n = static_cast<const Node48*>(node);
+                uint8_t index = n->childIndex[byte].load(std::memory_order_relaxed);
+                return index == 0 ? nullptr : &n->children[index - 1];
+            }
+            default: {
+                auto* n = static_cast<const Node256*>(node);
+                return n->children[byte].load(std::memory_order_relaxed) == 0 ? nullptr : &n->children[byte];
+            }
+        }
+    }
+
+    // Insert a child, keeping Node4/Node16 keys sorted; the node must have room
+    static void addChild(Node* node, uint8_t byte, Ref child) {
+        uint16_t count = node->count.load(std::memory_order_relaxed);
+        auto insertSorted = [&](std::atomic<uint8_t>* keys, std::atomic<Ref>* children) {
+            uint16_t pos = count;
+            while (pos > 0 && keys[pos - 1].load(std::memory_order_relaxed) > byte) {
+                keys[pos].store(keys[pos - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                children[pos].store(children[pos - 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                --pos;
+            }
+            keys[pos].store(byte, std::memory_order_relaxed);
+            children[pos].store(child, std::memory_order_release);
+        };
+        switch (node->type) {
+            case kNode4: insertSorted(static_cast<Node4*>(node)->keys, static_cast<Node4*>(node)->children); break;
+            case kNode16: insertSorted(static_cast<Node16*>(node)->keys, static_cast<Node16*>(node)->children); break;
+            case kNode48: {
+                auto* n = static_cast<Node48*>(node);
+                uint8_t slot = 0;
+                while (n->children[slot].load(std::memory_order_relaxed) != 0) {
+                    ++slot;
+                }
+                n->children[slot].store(child, std::memory_order_release);
+                n->childIndex[byte].store(static_cast<uint8_t>(slot + 1), std::memory_order_relaxed);
+                break;
+            }
+            default: static_cast<Node256*>(node)->children[byte].store(child, std::memory_order_release); break;
+        }
+        node->count.store(static_cast<uint16_t>(count + 1), std::memory_order_relaxed);
+    }
+
+    static void removeChild(Node* node, uint8_t byte) {
+        uint16_t count = node->count.load(std::memory_order_relaxed);
+        auto eraseSorted = [&](std::atomic<uint8_t>* keys, std::atomic<Ref>* children) {
+            uint16_t pos = 0;
+            while (keys[pos].load(std::memory_order_relaxed) != byte) {
+                ++pos;
+            }
+            for (; pos + 1 < count; ++pos) {
+                keys[pos].store(keys[pos + 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                children[pos].store(children[pos + 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            children[count - 1].store(0, std::memory_order_relaxed);
+        };
+        switch (node->type) {
+            case kNode4: eraseSorted(static_cast<Node4*>(node)->keys, static_cast<Node4*>(node)->children); break;
+            case kNode16: eraseSorted(static_cast<Node16*>(node)->keys, static_cast<Node16*>(node)->children); break;
+            case kNode48: {
+                auto* n = static_cast<Node48*>(node);
+                uint8_t index = n->childIndex[byte].load(std::memory_order_relaxed);
+                n->children[index - 1].store(0, std::memory_order_relaxed);
+                n->childIndex[byte].store(0, std::memory_order_relaxed);
+                break;
+            }
+            default: static_cast<Node256*>(node)->children[byte].store(0, std::memory_order_relaxed); break;
+        }
+        node->count.store(static_cast<uint16_t>(count - 1), std::memory_order_relaxed);
+    }
+
+    // Visit children in ascending byte order (writer side or under the write mutex)
+    template <typename Visitor>
+    static void forEachChild(const Node* node, Visitor&& visit) {
+        switch (node->type) {
+            case kNode4:
+            case kNode16: {
+                const std::atomic<uint8_t>* keys = node->type == kNode4 ? static_cast<const Node4*>(node)->keys
+                                                                        : static_cast<const Node16*>(node)->keys;
+                const std::atomic<Ref>* children = node->type == kNode4 ? static_cast<const Node4*>(node)->children
+                                                                        : static_cast<const Node16*>(node)->children;
+                for (uint16_t i = 0; i < node->count.load(std::memory_order_relaxed); ++i) {
+                    visit(keys[i].load(std::memory_order_relaxed), children[i].load(std::memory_order_relaxed));
+                }
+                break;
+            }
+            case kNode48: {
+                auto* n = static_cast<const Node48*>(node);
+                for (int byte = 0; byte < 256; ++byte) {
+                    uint8_t index = n->childIndex[byte].load(std::memory_order_relaxed);
+                    if (index != 0) {
+                        visit(static_cast<uint8_t>(byte), n->children[index - 1].load(std::memory_order_relaxed));
+                    }
+                }
+                break;
+            }
+            default: {
+                auto* n = static_cast<const Node256*>(node);
+                for (int byte = 0; byte < 256; ++byte) {
+                    Ref child = n->children[byte].load(std::memory_order_relaxed);
+                    if (child != 0) {
+                        visit(static_cast<uint8_t>(byte), child);
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    // Build an unpublished copy of a node with a different type and/or prefix
+    static Node* copyNode(const Node* node, NodeType type, std::string prefix) {
+        Node* copy = newNode(type, std::move(prefix));
+        copy->terminal.store(node->terminal.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        forEachChild(node, [copy](uint8_t byte, Ref child) { addChild(copy, byte, child); });
+        return copy;
+    }
+
+    // Attach a new leaf for bytes[pos..] to an unpublished node
+    static void placeLeaf(Node* node, std::string_view bytes, size_t pos, std::string_view value) {
+        if (pos == bytes.size()) {
+            node->terminal.store(makeLeaf(std::string_view(), value), std::memory_order_relaxed);
+        } else {
+            addChild(node, static_cast<uint8_t>(bytes[pos]), makeLeaf(bytes.substr(pos + 1), value));
+        }
+    }
+
+    // After a removal, replace a node that holds a single entry by that entry (re-compressing the
+    // path), or move a sparse node to a smaller node type
+    void compact(Node* node, std::atomic<Ref>* slot, Node* owner) {
+        uint16_t count = node->count.load(std::memory_order_relaxed);
+        Ref terminal = node->terminal.load(std::memory_order_relaxed);
+        if (count + (terminal != 0 ? 1 : 0) == 1) {
+            Ref replacement;
+            if (terminal != 0) {
+                replacement = makeLeaf(node->prefix, asLeaf(terminal)->value());
+                retire(terminal);
+            } else {
+                uint8_t byte = 0;
+                Ref child = 0;
+                forEachChild(node, [&](uint8_t b, Ref c) { byte = b; child = c; });
+                std::string path = node->prefix + static_cast<char>(byte);
+                if (isLeaf(child)) {
+                    replacement = makeLeaf(path.append(asLeaf(child)->suffix()), asLeaf(child)->value());
+                } else {
+                    Node* inner = asNode(child);
+                    replacement = nodeRef(copyNode(inner, inner->type, path + inner->prefix));
+                }
+                retire(child);
+            }
+            publish(slot, owner, replacement);
+            retire(nodeRef(node));
+            return;
+        }
+        static const uint16_t shrinkAt[] = {0, 3, 12, 37};
+        if (node->type != kNode4 && count <= shrinkAt[node->type]) {
+            publish(slot, owner, nodeRef(copyNode(node, static_cast<NodeType>(node->type - 1), node->prefix)));
+            retire(nodeRef(node));
+        }
+    }
+
+    // Unlinked nodes are marked obsolete so optimistic readers restart, then freed after a grace period
+    void retire(Ref ref) {
+        if (!isLeaf(ref)) {
+            asNode(ref)->version.fetch_or(1, std::memory_order_release);  // Mark obsolete
+        }
+        epochs_.retire(reinterpret_cast<void*>(ref), [](void* retired) { freeRef(reinterpret_cast<Ref>(retired)); });
+    }
+
+    static void freeRef(Ref ref) {
+        if (isLeaf(ref)) {
+            ::operator delete(asLeaf(ref));
+            return;
+        }
+        Node* node = asNode(ref);
+        switch (node->type) {
+            case kNode4: delete static_cast<Node4*>(node); break;
+            case kNode16: delete static_cast<Node16*>(node); break;
+            case kNode48: delete static_cast<Node48*>(node); break;
+            default: delete static_cast<Node256*>(node); break;
+        }
+    }
+
+    static void freeTree(Ref ref) {
+        if (ref == 0) {
+            return;
+        }
+        if (!isLeaf(ref)) {
+            Node* node = asNode(ref);
+            freeTree(node->terminal.load(std::memory_order_relaxed));
+            forEachChild(node, [](uint8_t, Ref child) { freeTree(child); });
+        }
+        freeRef(ref);
+    }
+
+    // One optimistic lookup attempt; returns false if it has to be restarted
+    bool tryGet(const std::string& key, std::string& value, bool& found) const {
+        const Node* parent = nullptr;
+        uint64_t parentVersion = 0;
+        Ref ref = root_.load(std::memory_order_acquire);
+        size_t depth = 0;
+        for (;;) {
+            if (ref == 0 || isLeaf(ref)) {
+                found = ref != 0 && key.compare(depth, std::string::npos, asLeaf(ref)->suffix()) == 0;
+                if (found) {
+                    value = asLeaf(ref)->value();
+                }
+                return parent == nullptr || validate(parent, parentVersion);
+            }
+            const Node* node = asNode(ref);
+            uint64_t version;
+            if (!readLock(node, version) || (parent != nullptr && !validate(parent, parentVersion))) {
+                return false;
+            }
+            if (key.compare(depth, node->prefix.size(), node->prefix) != 0) {
+                found = false;
+                return validate(node, version);
+            }
+            depth += node->prefix.size();
+            if (depth == key.size()) {
+                ref = node->terminal.load(std::memory_order_acquire);
+            } else {
+                const std::atomic<Ref>* child = findChild(node, static_cast<uint8_t>(key[depth]));
+                ref = child != nullptr ? child->load(std::memory_order_acquire) : 0;
+                ++depth;
+            }
+            parent = node;
+            parentVersion = version;
+        }
+    }
+
+    template <typename Visitor>
+    static bool visitLeaf(const std::string& key, const Leaf* leaf, const std::string& begin,
+                          const std::string& end, Visitor& visit) {
+        if (!end.empty() && key >= end) {
+            return false;
+        }
+        return key < begin || visit(key, leaf->value());
+    }
+
+    // In-order traversal that skips subtrees entirely below begin and stops at end
+    template <typename Visitor>
+    static bool scan(Ref ref, std::string& path, const std::string& begin, const std::string& end, Visitor& visit) {
+        if (ref == 0) {
+            return true;
+        }
+        if (isLeaf(ref)) {
+            return visitLeaf(path + std::string(asLeaf(ref)->suffix()), asLeaf(ref), begin, end, visit);
+        }
+        const Node* node = asNode(ref);
+        size_t mark = path.size();
+        path += node->prefix;
+        size_t n = std::min(path.size(), begin.size());
+        bool keepGoing = true;
+        if (!end.empty() && path >= end) {
+            keepGoing = false;
+        } else if (path.compare(0, n, begin, 0, n) >= 0) {
+            Ref terminal = node->terminal.load(std::memory_order_relaxed);
+            keepGoing = terminal == 0 || visitLeaf(path, asLeaf(terminal), begin, end, visit);
+            forEachChild(node, [&](uint8_t byte, Ref child) {
+                if (keepGoing) {
+                    path.push_back(static_cast<char>(byte));
+                    keepGoing = scan(child, path, begin, end, visit);
+                    path.pop_back();
+                }
+            });
+        }
+        path.resize(mark);
+        return keepGoing;
+    }
+
+    static size_t heapBytes(const std::string& s) { return s.capacity() > 15 ? s.capacity() + 1 : 0; }
+
+    static size_t memoryOf(Ref ref) {
+        if (ref == 0) {
+            return 0;
+        }
+        if (isLeaf(ref)) {
+            return sizeof(Leaf) + asLeaf(ref)->suffixSize + asLeaf(ref)->valueSize;
+        }
+        const Node* node = asNode(ref);
+        static const size_t nodeSizes[] = {sizeof(Node4), sizeof(Node16), sizeof(Node48), sizeof(Node256)};
+        size_t total = nodeSizes[node->type] + heapBytes(node->prefix) +
+                       memoryOf(node->terminal.load(std::memory_order_relaxed));
+        forEachChild(node, [&total](uint8_t, Ref child) { total += memoryOf(child); });
+        return total;
+    }
+
+    std::atomic<Ref> root_{0};                    // Root slot
+    std::atomic<size_t> size_{0};                 // Number of stored pairs
+    std::mutex writeMutex_;                       // Serializes writers and scans
+    EpochReclaimer epochs_;                       // Frees unlinked nodes and leaves
+};
+
+// Cuckoo Hash Table Module: Concurrent hash table in the style of libcuckoo. Every key has two
+// candidate buckets of four slots, and writers lock only the stripes covering those two buckets, so
+// writes to different keys rarely contend. Readers take no lock: they scan both buckets and retry if
+// a stripe version changed meanwhile. Entries are immutable (an update swaps in a new entry) and are
+// freed once no reader can still hold them.
+class CuckooTable {
+public:
+    // Contention and maintenance counters
+    struct Stats {
+        uint64_t readRetries = 0;     // Optimistic reads repeated after a concurrent change
+        uint64_t displacements = 0;   // Entries moved to their alternate bucket to make room
+        uint64_t resizes = 0;         // Table doublings
+    };
 
-    // Load data from the database file into an unordered_map
-    [[nodiscard]] std::unordered_map<std::string, std::string> load() const {
-        std::unordered_map<std::string, std::string> db;
-        std::ifstream dbFile(dbFileName_);
-        std::string key, value;
-        while (dbFile >> key >> value) {
-            db[key] = value;
+    explicit CuckooTable(size_t initialBuckets = 1024) {
+        size_t buckets = 16;
+        while (buckets < initialBuckets) {
+            buckets *= 2;
         }
-        dbFile.close();
-        return db;
+        table_.store(new Table(buckets), std::memory_order_release);
     }
 
-    // Save the in-memory database to the disk by writing to the database file
-    void save(const std::unordered_map<std::string, std::string>& db) const {
-        std::ofstream dbFile(dbFileName_, std::ios_base::trunc);
-        for (const auto& pair : db) {
-            dbFile << pair.first << " " << pair.second << "\n";
+    ~CuckooTable() {
+        Table* table = table_.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < table->slots.size(); ++i) {
+            ::operator delete(table->slots[i].load(std::memory_order_relaxed));
         }
-        dbFile.close();
+        delete table;  // epochs_ frees the retired entries and tables
+    }
+
+    CuckooTable(const CuckooTable&) = delete;
+    CuckooTable& operator=(const CuckooTable&) = delete;
+
+    // Insert or update a key-value pair
+    void put(const std::string& key, const std::string& value) {
+        uint64_t hash = mixedHash(key);
+        Entry* fresh = makeEntry(hash, key, value);
+        Entry* replaced = nullptr;
+        {
+            EpochReclaimer::Guard guard(epochs_);  // Keeps the bucket array alive while waiting for its stripes
+            for (bool stored = false; !stored;) {
+                Table* table = table_.load(std::memory_order_acquire);
+                size_t first = table->primary(hash), second = table->alternate(hash);
+                StripeLock lock(*table, first, second);
+                if (table_.load(std::memory_order_acquire) != table) {
+                    continue;  // Resized while we waited for the stripes
+                }
+                std::atomic<Entry*>* free = nullptr;
+                std::atomic<Entry*>* existing = findSlot(*table, first, second, hash, key, &free);
+                if (existing != nullptr) {
+                    replaced = existing->exchange(fresh, std::memory_order_acq_rel);
+                    stored = true;
+                } else if (free != nullptr) {
+                    free->store(fresh, std::memory_order_release);
+                    table->stripeFor(first).count.fetch_add(1, std::memory_order_relaxed);
+                    stored = true;
+                } else {
+                    lock.unlock();
+                    makeRoom(table, first, second);  // Both buckets are full
+                }
+            }
+        }
+        if (replaced != nullptr) {
+            retire(replaced);
+        }
+    }
+
+    // Retrieve the value associated with a key
+    std::string get(const std::string& key) const {
+        uint64_t hash = mixedHash(key);
+        EpochReclaimer::Guard guard(epochs_);
+        const Table* table = table_.load(std::memory_order_acquire);
+        size_t first = table->primary(hash), second = table->alternate(hash);
+        const Stripe& firstStripe = table->stripeFor(first);
+        const Stripe& secondStripe = table->stripeFor(second);
+        for (;;) {
+            uint64_t firstVersion = firstStripe.version.load(std::memory_order_acquire);
+            uint64_t secondVersion = secondStripe.version.load(std::memory_order_acquire);
+            if (((firstVersion | secondVersion) & 1) != 0) {
+                std::this_thread::yield();  // A writer holds one of the stripes
+                continue;
+            }
+            const Entry* found = nullptr;
+            for (size_t bucket : {first, second}) {
+                for (size_t i = 0; i < kSlotsPerBucket && found == nullptr; ++i) {
+                    const Entry* entry = table->slot(bucket, i).load(std::memory_order_acquire);
+                    if (entry != nullptr && entry->hash == hash && entry->key() == key) {
+                        found = entry;
+                    }
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (firstStripe.version.load(std::memory_order_relaxed) == firstVersion &&
+                secondStripe.version.load(std::memory_order_relaxed) == secondVersion) {
+                return found != nullptr ? std::string(found->value()) : "Key not found";
+            }
+            readRetries_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Remove a key-value pair
+    void remove(const std::string& key) {
+        uint64_t hash = mixedHash(key);
+        Entry* removed = nullptr;
+        {
+            EpochReclaimer::Guard guard(epochs_);
+            for (;;) {
+                Table* table = table_.load(std::memory_order_acquire);
+                size_t first = table->primary(hash), second = table->alternate(hash);
+                StripeLock lock(*table, first, second);
+                if (table_.load(std::memory_order_acquire) != table) {
+                    continue;
+                }
+                std::atomic<Entry*>* existing = findSlot(*table, first, second, hash, key, nullptr);
+                if (existing != nullptr) {
+                    removed = existing->exchange(nullptr, std::memory_order_acq_rel);
+                    table->stripeFor(first).count.fetch_sub(1, std::memory_order_relaxed);
+                }
+                break;
+            }
+        }
+        if (removed != nullptr) {
+            retire(removed);
+        }
+    }
+
+    // Number of stored pairs
+    size_t size() const {
+        EpochReclaimer::Guard guard(epochs_);
+        const Table* table = table_.load(std::memory_order_acquire);
+        int64_t total = 0;
+        for (const Stripe& stripe : table->stripes) {
+            total += stripe.count.load(std::memory_order_relaxed);
+        }
+        return static_cast<size_t>(std::max<int64_t>(total, 0));
+    }
+
+    // Contention and maintenance counters
+    Stats stats() const {
+        Stats stats;
+        stats.readRetries = readRetries_.load(std::memory_order_relaxed);
+        stats.displacements = displacements_.load(std::memory_order_relaxed);
+        stats.resizes = resizes_.load(std::memory_order_relaxed);
+        return stats;
     }
 
 private:
-    std::string dbFileName_;  // Name of the database file
+    static constexpr size_t kSlotsPerBucket = 4;
+    static constexpr size_t kMaxStripes = 4096;
+    static constexpr size_t kMaxSearch = 512;     // Buckets visited when searching a displacement path
+    static constexpr size_t kReclaimBatch = 256;
+
+    // Immutable key-value pair in a single allocation
+    struct Entry {
+        uint64_t hash;
+        uint32_t keySize;
+        uint32_t valueSize;
+        std::string_view key() const { return std::string_view(reinterpret_cast<const char*>(this + 1), keySize); }
+        std::string_view value() const {
+            return std::string_view(reinterpret_cast<const char*>(this + 1) + keySize, valueSize);
+        }
+    };
+
+    // Version word: odd while a writer holds the stripe
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> version{0};
+        std::atomic<int64_t> count{0};  // Entries whose primary bucket maps to this stripe
+    };
+
+    struct Table {
+        explicit Table(size_t bucketCount)
+            : mask(bucketCount - 1), slots(bucketCount * kSlotsPerBucket),
+              stripes(std::min(bucketCount, kMaxStripes)) {}
+
+        size_t primary(uint64_t hash) const { return hash & mask; }
+        size_t alternate(uint64_t hash) const {
+            size_t bucket = ((hash >> 32) * 0xc6a4a7935bd1e995ull) & mask;
+            return bucket != primary(hash) ? bucket : (bucket + 1) & mask;
+        }
+        size_t other(const Entry* entry, size_t bucket) const {
+            return bucket == primary(entry->hash) ? alternate(entry->hash) : primary(entry->hash);
+        }
+        std::atomic<Entry*>& slot(size_t bucket, size_t i) { return slots[bucket * kSlotsPerBucket + i]; }
+        const std::atomic<Entry*>& slot(size_t bucket, size_t i) const { return slots[bucket * kSlotsPerBucket + i]; }
+        Stripe& stripeFor(size_t bucket) { return stripes[bucket & (stripes.size() - 1)]; }
+        const Stripe& stripeFor(size_t bucket) const { return stripes[bucket & (stripes.size() - 1)]; }
+
+        size_t mask;
+        std::vector<std::atomic<Entry*>> slots;
+        std::vector<Stripe> stripes;
+    };
+
+    // Holds the stripes of two buckets, locked in index order to avoid deadlock
+    class StripeLock {
+    public:
+        StripeLock(Table& table, size_t firstBucket, size_t secondBucket) {
+            Stripe* a = &table.stripeFor(firstBucket);
+            Stripe* b = &table.stripeFor(secondBucket);
+            if (a > b) {
+                std::swap(a, b);
+            }
+            lock(*a);
+            stripes_[0] = a;
+            if (b != a) {
+                lock(*b);
+                stripes_[1] = b;
+            }
+        }
+        ~StripeLock() { unlock(); }
+
+        void unlock() {
+            for (Stripe*& stripe : stripes_) {
+                if (stripe != nullptr) {
+                    stripe->version.fetch_add(1, std::memory_order_release);
+                    stripe = nullptr;
+                }
+            }
+        }
+
+        static void lock(Stripe& stripe) {
+            for (;;) {
+                uint64_t version = stripe.version.load(std::memory_order_relaxed);
+                if ((version & 1) == 0 &&
+                    stripe.version.compare_exchange_weak(version, version + 1, std::memory_order_acquire)) {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+    private:
+        Stripe* stripes_[2] = {nullptr, nullptr};
+    };
+
+    // FNV-1a with its high bits folded in, since both bucket indexes come from the low bits
+    static uint64_t mixedHash(const std::string& key) {
+        uint64_t hash = hashKey(key);
+        return hash ^ (hash >> 29);
+    }
+
+    static Entry* makeEntry(uint64_t hash, const std::string& key, const std::string& value) {
+        void* memory = ::operator new(sizeof(Entry) + key.size() + value.size());
+        Entry* entry = new (memory) Entry{hash, static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size())};
+        std::memcpy(entry + 1, key.data(), key.size());
+        if (!value.empty()) {
+            std::memcpy(reinterpret_cast<char*>(entry + 1) + key.size(), value.data(), value.size());
+        }
+        return entry;
+    }
+
+    // Slot holding the key in either bucket; optionally reports the first free slot seen
+    static std::atomic<Entry*>* findSlot(Table& table, size_t first, size_t second, uint64_t hash,
+                                         const std::string& key, std::atomic<Entry*>** free) {
+        for (size_t bucket : {first, second}) {
+            for (size_t i = 0; i < kSlotsPerBucket; ++i) {
+                std::atomic<Entry*>& slot = table.slot(bucket, i);
+                Entry* entry = slot.load(std::memory_order_relaxed);
+                if (entry == nullptr) {
+                    if (free != nullptr && *free == nullptr) {
+                        *free = &slot;
+                    }
+                } else if (entry->hash == hash && entry->key() == key) {
+                    return &slot;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    static std::atomic<Entry*>* freeSlot(Table& table, size_t bucket) {
+        for (size_t i = 0; i < kSlotsPerBucket; ++i) {
+            if (table.slot(bucket, i).load(std::memory_order_relaxed) == nullptr) {
+                return &table.slot(bucket, i);
+            }
+        }
+        return nullptr;
+    }
+
+    // Free a slot in one of the two buckets by moving entries along a cuckoo path, found by a
+    // breadth-first search and executed back to front, or double the table if no path exists
+    void makeRoom(Table* table, size_t first, size_t second) {
+        std::lock_guard<std::mutex> lock(displaceMutex_);
+        if (table_.load(std::memory_order_acquire) != table) {
+            return;
+        }
+        struct Step {
+            size_t bucket;
+            int parent;      // Index of the step whose entry moves into this bucket
+            size_t slot;     // Slot of that entry in the parent bucket
+        };
+        std::vector<Step> steps{{first, -1, 0}, {second, -1, 0}};
+        for (size_t at = 0; at < steps.size() && steps.size() < kMaxSearch; ++at) {
+            if (freeSlot(*table, steps[at].bucket) != nullptr) {
+                executePath(*table, steps, static_cast<int>(at));
+                return;  // The caller retries whether or not the path still held
+            }
+            for (size_t i = 0; i < kSlotsPerBucket; ++i) {
+                Entry* entry = table->slot(steps[at].bucket, i).load(std::memory_order_relaxed);
+                if (entry != nullptr) {
+                    steps.push_back({table->other(entry, steps[at].bucket), static_cast<int>(at), i});
+                }
+            }
+        }
+        resize(table);
+    }
+
+    template <typename Steps>
+    void executePath(Table& table, const Steps& steps, int at) {
+        while (steps[static_cast<size_t>(at)].parent >= 0) {
+            const auto& step = steps[static_cast<size_t>(at)];
+            size_t from = steps[static_cast<size_t>(step.parent)].bucket;
+            StripeLock lock(table, from, step.bucket);
+            std::atomic<Entry*>& source = table.slot(from, step.slot);
+            Entry* entry = source.load(std::memory_order_relaxed);
+            std::atomic<Entry*>* target = freeSlot(table, step.bucket);
+            if (entry == nullptr || target == nullptr || table.other(entry, from) != step.bucket) {
+                return;  // A concurrent writer changed the path
+            }
+            target->store(entry, std::memory_order_release);  // Copy first so readers never miss it
+            source.store(nullptr, std::memory_order_release);  // Counts follow the primary bucket, unchanged
+            displacements_.fetch_add(1, std::memory_order_relaxed);
+            at = step.parent;
+        }
+    }
+
+    // Double the bucket count with every stripe of the old table held, then publish the new table
+    void resize(Table* table) {
+        for (Stripe& stripe : table->stripes) {
+            StripeLock::lock(stripe);
+        }
+        size_t buckets = (table->mask + 1) * 2;
+        Table* grown = nullptr;
+        while (grown == nullptr) {
+            grown = rebuild(*table, buckets);
+            buckets *= 2;
+        }
+        table_.store(grown, std::memory_order_release);
+        for (Stripe& stripe : table->stripes) {
+            stripe.version.fetch_add(1, std::memory_order_release);
+        }
+        resizes_.fetch_add(1, std::memory_order_relaxed);
+        epochs_.retire(table, [](void* retired) { delete static_cast<Table*>(retired); });
+    }
+
+    // Single-threaded cuckoo insertion of every entry into a new table; nullptr if one does not fit
+    static Table* rebuild(const Table& table, size_t buckets) {
+        auto grown = std::make_unique<Table>(buckets);
+        for (size_t s = 0; s < table.slots.size(); ++s) {
+            Entry* pending = table.slots[s].load(std::memory_order_relaxed);
+            if (pending == nullptr) {
+                continue;
+            }
+            grown->stripeFor(grown->primary(pending->hash)).count.fetch_add(1, std::memory_order_relaxed);
+            size_t bucket = grown->primary(pending->hash);
+            for (size_t kick = 0; pending != nullptr; ++kick) {
+                if (kick == kMaxSearch) {
+                    return nullptr;  // The entries still belong to the old table
+                }
+                if (std::atomic<Entry*>* free = freeSlot(*grown, bucket)) {
+                    free->store(pending, std::memory_order_relaxed);
+                    pending = nullptr;
+                } else if (kick == 0) {
+                    bucket = grown->alternate(pending->hash);
+                } else {
+                    pending = grown->slot(bucket, kick % kSlotsPerBucket).exchange(pending, std::memory_order_relaxed);
+                    bucket = grown->other(pending, bucket);
+                }
+            }
+        }
+        return grown.release();
+    }
+
+    // Unlinked entries are freed after a grace period, in batches
+    void retire(Entry* entry) {
+        epochs_.retire(entry, [](void* retired) { ::operator delete(retired); });
+        epochs_.reclaim();
+    }
+
+    std::atomic<Table*> table_{nullptr};              // Current bucket array
+    std::mutex displaceMutex_;                        // Serializes cuckoo path searches and resizes
+    EpochReclaimer epochs_{kReclaimBatch};            // Frees replaced entries and bucket arrays
+    mutable std::atomic<uint64_t> readRetries_{0};
+    std::atomic<uint64_t> displacements_{0};
+    std::atomic<uint64_t> resizes_{0};
 };
 
-// Write-Ahead Logging (WAL) Module: Manages logging of operations for durability and recovery
-class WAL {
+// Seqlock Slot Module: In-place slot for a value of up to 64 bytes, protected by a sequence counter.
+// Writers make the counter odd, copy the bytes and make it even again; readers copy the bytes and
+// retry if the counter was odd or changed, so they never write shared memory and nothing allocates.
+class SeqlockSlot {
 public:
-    // Constructor initializes the WAL with the log file name
-    explicit WAL(std::string  walFileName) : walFileName_(std::move(walFileName)) {}
+    static constexpr size_t kCapacity = 64;
+    static constexpr uint32_t kAbsent = std::numeric_limits<uint32_t>::max();
 
-    // Log a write (PUT) operation to the WAL
-    void logWriteOperation(const std::string& key, const std::string& value) const {
-        std::ofstream walFile(walFileName_, std::ios_base::app);
-        walFile << "PUT " << key << " " << value << "\n";
-        walFile.close();
+    // Overwrite the value in place; returns false if it does not fit
+    bool store(std::string_view value) {
+        if (value.size() > kCapacity) {
+            return false;
+        }
+        uint64_t words[kWords] = {};
+        std::memcpy(words, value.data(), value.size());
+        write(static_cast<uint32_t>(value.size()), words);
+        return true;
     }
 
-    // Log a delete (DEL) operation to the WAL
-    void logDeleteOperation(const std::string& key) const {
-        std::ofstream walFile(walFileName_, std::ios_base::app);
-        walFile << "DEL " << key << "\n";
-        walFile.close();
+    // Mark the slot empty
+    void clear() {
+        uint64_t words[kWords] = {};
+        write(kAbsent, words);
     }
 
-    // Apply the operations recorded in the WAL to the in-memory database
-    void applyLog(std::unordered_map<std::string, std::string>& db) const {
-        std::ifstream walFile(walFileName_);
-        std::string operation, key, value;
-        while (walFile >> operation >> key) {
-            if (operation == "PUT") {
-                walFile >> value;
-                db[key] = value;
-            } else if (operation == "DEL") {
-                db.erase(key);
+    // Copy the value into buffer (at least kCapacity bytes); returns its size, or kAbsent if empty
+    uint32_t load(char* buffer) const {
+        uint64_t words[kWords];
+        for (;;) {
+            uint64_t sequence = sequence_.load(std::memory_order_acquire);
+            if ((sequence & 1) != 0) {
+                std::this_thread::yield();  // A writer is mid-update
+                continue;
+            }
+            uint32_t size = size_.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kWords; ++i) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == sequence) {
+                if (size != kAbsent) {
+                    std::memcpy(buffer, words, size);
+                }
+                return size;
             }
         }
-        walFile.close();
     }
 
-    // Clear the WAL after merging logs with the main database
-    void clearLog() const {
-        std::ofstream walFile(walFileName_, std::ios_base::trunc);
-        walFile.close();
+private:
+    static constexpr size_t kWords = kCapacity / 8;
+
+    void write(uint32_t size, const uint64_t* words) {
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        while ((sequence & 1) != 0 ||
+               !sequence_.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+            std::this_thread::yield();  // Another writer holds the slot
+            sequence = sequence_.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        size_.store(size, std::memory_order_relaxed);
+        for (size_t i = 0; i < kWords; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<uint64_t> sequence_{0};
+    std::atomic<uint32_t> size_{kAbsent};
+    std::atomic<uint64_t> words_[kWords]{};  // Value bytes, copied word by word
+};
+
+// Small Value Table Module: Fixed-capacity table of seqlock slots for small, frequently overwritten
+// values such as hot counters. A key's slot is allocated on its first put and never moves or goes
+// away (remove only clears it), so after that gets and puts are lock-free and allocation-free.
+class SmallValueTable {
+public:
+    static constexpr size_t kMaxValueSize = SeqlockSlot::kCapacity;
+
+    // capacity is the maximum number of distinct keys ever stored
+    explicit SmallValueTable(size_t capacity = 65536) {
+        size_t slots = 16;
+        while (slots < capacity * 2) {
+            slots *= 2;
+        }
+        entries_ = std::vector<std::atomic<Entry*>>(slots);
+    }
+
+    ~SmallValueTable() {
+        for (auto& entry : entries_) {
+            delete entry.load(std::memory_order_relaxed);
+        }
+    }
+
+    SmallValueTable(const SmallValueTable&) = delete;
+    SmallValueTable& operator=(const SmallValueTable&) = delete;
+
+    // Insert or update a value of at most kMaxValueSize bytes; returns false if the value is too
+    // large or the table has no room for a new key
+    bool put(const std::string& key, std::string_view value) {
+        if (value.size() > kMaxValueSize) {
+            return false;
+        }
+        Entry* entry = findOrCreate(key);
+        return entry != nullptr && entry->slot.store(value);
+    }
+
+    // Copy the value into buffer (at least kMaxValueSize bytes) without allocating; returns its
+    // size, or SeqlockSlot::kAbsent if the key is not present
+    uint32_t read(const std::string& key, char* buffer) const {
+        const Entry* entry = lookup(key);
+        return entry != nullptr ? entry->slot.load(buffer) : SeqlockSlot::kAbsent;
+    }
+
+    // Retrieve the value associated with a key
+    std::string get(const std::string& key) const {
+        char buffer[kMaxValueSize];
+        uint32_t size = read(key, buffer);
+        return size != SeqlockSlot::kAbsent ? std::string(buffer, size) : "Key not found";
+    }
+
+    // Remove a key-value pair (its slot stays allocated for a later put)
+    void remove(const std::string& key) {
+        if (Entry* entry = lookup(key)) {
+            entry->slot.clear();
+        }
     }
 
 private:
-    std::string walFileName_;  // Name of the WAL file
+    struct Entry {
+        explicit Entry(std::string entryKey) : key(std::move(entryKey)) {}
+        const std::string key;
+        SeqlockSlot slot;
+    };
+
+    // Linear probing over published entries
+    Entry* lookup(const std::string& key) const {
+        size_t mask = entries_.size() - 1;
+        for (size_t i = hashKey(key) & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+            Entry* entry = entries_[i].load(std::memory_order_acquire);
+            if (entry == nullptr || entry->key == key) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    // Like lookup, but claims the first empty position for a new key with a compare-and-swap
+    Entry* findOrCreate(const std::string& key) {
+        size_t mask = entries_.size() - 1;
+        Entry* fresh = nullptr;
+        for (size_t i = hashKey(key) & mask, probes = 0; probes <= mask; i = (i + 1) & mask, ++probes) {
+            Entry* entry = entries_[i].load(std::memory_order_acquire);
+            if (entry == nullptr) {
+                if (fresh == nullptr) {
+                    fresh = new Entry(key);
+                }
+                if (entries_[i].compare_exchange_strong(entry, fresh, std::memory_order_acq_rel)) {
+                    return fresh;
+                }
+            }
+            if (entry->key == key) {
+                delete fresh;  // Another writer created the key first
+                return entry;
+            }
+        }
+        delete fresh;
+        return nullptr;  // Table full
+    }
+
+    std::vector<std::atomic<Entry*>> entries_;  // Open addressing; entries are never unlinked
 };
 
-// Core Database Module: Manages data operations, concurrency control, persistence, and logging
-class ExDB {
+// Log-Structured Storage Module: Bitcask-style engine where append-only data files are the primary store.
+// Only an in-memory key directory is kept; values stay on disk and are read with pread on demand.
+class LogStore {
 public:
-    // Constructor initializes Storage and WAL modules and loads existing data
-    ExDB(const std::string& dbFileName, const std::string& walFileName)
-        : storage_(dbFileName), wal_(walFileName) {
-        // Load persisted data from disk
-        db_ = storage_.load();
-        // Apply any pending operations from the WAL
-        wal_.applyLog(db_);
+    // Constructor opens (or creates) the data directory and rebuilds the key directory from hint/data files
+    explicit LogStore(std::string dirName, uint64_t maxFileSize = 64ull << 20, IOScheduler* scheduler = nullptr)
+        : dirName_(std::move(dirName)), maxFileSize_(maxFileSize), scheduler_(scheduler) {
+        std::filesystem::create_directories(dirName_);
+        uint64_t lastId = loadKeyDir();
+        openActiveFile(lastId + 2 - lastId % 2);  // Active files use even ids, merge outputs odd ones
     }
 
-    // Insert or update a key-value pair
+    ~LogStore() {
+        stopBackgroundMerge();
+        for (const auto& pair : fds_) {
+            ::close(pair.second);
+        }
+    }
+
+    LogStore(const LogStore&) = delete;
+    LogStore& operator=(const LogStore&) = delete;
+
+    // Insert or update a key-value pair by appending a record to the active data file
     void put(const std::string& key, const std::string& value) {
-        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
-        db_[key] = value;                                   // Update in-memory database
-        wal_.logWriteOperation(key, value);                 // Log the operation for persistence
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        uint64_t offset = appendRecord(key, value.data(), static_cast<uint32_t>(value.size()));
+        KeyDirEntry entry{activeId_, offset + kHeaderSize + key.size(), static_cast<uint32_t>(value.size())};
+        auto it = keyDir_.find(key);
+        if (it != keyDir_.end()) {
+            markDead(key, it->second);
+            it->second = entry;
+        } else {
+            keyDir_.emplace(key, entry);
+        }
     }
 
-    // Retrieve the value associated with a key
+    // Retrieve the value associated with a key, reading it from its data file
     std::string get(const std::string& key) {
-        std::shared_lock<std::shared_mutex> lock(mutex_);  // Acquire shared lock for reading
-        auto it = db_.find(key);
-        if (it != db_.end()) {
-            return it->second;
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = keyDir_.find(key);
+        if (it == keyDir_.end()) {
+            return "Key not found";
         }
-        return "Key not found";
+        const KeyDirEntry& entry = it->second;
+        std::string value(entry.valueSize, '\0');
+        if (!preadFully(fds_.at(entry.fileId), &value[0], entry.valueSize, entry.valueOffset)) {
+            return "Key not found";
+        }
+        return value;
     }
 
-    // Remove a key-value pair
+    // Remove a key-value pair by appending a tombstone record
     void remove(const std::string& key) {
-        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
-        db_.erase(key);                                     // Remove from in-memory database
-        wal_.logDeleteOperation(key);                      // Log the operation for persistence
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = keyDir_.find(key);
+        if (it == keyDir_.end()) {
+            return;  // Nothing live on disk, so no tombstone is needed
+        }
+        appendRecord(key, nullptr, kTombstone);
+        markDead(key, it->second);
+        fileStats_[activeId_].deadBytes += kHeaderSize + key.size();
+        keyDir_.erase(it);
     }
 
-    // Merge the WAL with the main database file and clear the WAL
-    void mergeLogs() {
-        std::unique_lock<std::shared_mutex> lock(mutex_);  // Acquire exclusive lock for writing
-        storage_.save(db_);                                 // Save the current state to disk
-        wal_.clearLog();                                    // Clear the WAL after merging
+    // Rewrite all live records of the immutable files into one compacted file plus a hint file.
+    // Writers only block for the rotation at the start and the key directory swap at the end.
+    // Returns false, leaving every source file in place, if a record cannot be copied.
+    bool merge() {
+        std::lock_guard<std::mutex> mergeLock(mergeMutex_);
+        uint64_t mergeId;
+        std::map<uint64_t, int> sources;
+        std::vector<std::pair<std::string, KeyDirEntry>> live;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            mergeId = activeId_ + 1;
+            sources = fds_;
+            openActiveFile(activeId_ + 2);  // Everything written so far is now immutable
+            live.assign(keyDir_.begin(), keyDir_.end());
+        }
+
+        std::vector<Moved> moved;
+        moved.reserve(live.size());
+        std::string dataPath = filePath(mergeId, ".data");
+        std::string hintPath = filePath(mergeId, ".hint");
+        uint64_t mergedBytes = 0;
+        if (!live.empty()) {
+            int out = ::open((dataPath + ".tmp").c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+            bool copied = out >= 0;
+            std::string hints;
+            std::string value;
+            for (auto pair = live.begin(); copied && pair != live.end(); ++pair) {
+                const KeyDirEntry& old = pair->second;
+                value.resize(old.valueSize);
+                if (!preadFully(sources.at(old.fileId), &value[0], old.valueSize, old.valueOffset)) {
+                    copied = false;
+                    break;
+                }
+                std::string record = encodeRecord(pair->first, value.data(), old.valueSize);
+                if (scheduler_ != nullptr) {
+                    scheduler_->acquire(IOClass::Compaction, value.size() + record.size());  // Read + write
+                }
+                copied = writeFully(out, record);
+                KeyDirEntry entry{mergeId, mergedBytes + kHeaderSize + pair->first.size(), old.valueSize};
+                mergedBytes += record.size();
+                appendHint(hints, pair->first, entry);
+                moved.push_back(Moved{pair->first, old, entry});
+            }
+            copied = copied && ::fsync(out) == 0;
+            if (out >= 0) {
+                ::close(out);
+            }
+            int hintFd = copied ? ::open((hintPath + ".tmp").c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644) : -1;
+            copied = hintFd >= 0 && writeFully(hintFd, hints) && ::fsync(hintFd) == 0;
+            if (hintFd >= 0) {
+                ::close(hintFd);
+            }
+            if (!copied) {
+                std::filesystem::remove(dataPath + ".tmp");  // The sources stay authoritative
+                std::filesystem::remove(hintPath + ".tmp");
+                return false;
+            }
+            std::filesystem::rename(dataPath + ".tmp", dataPath);
+            std::filesystem::rename(hintPath + ".tmp", hintPath);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        FileStats mergedStats{mergedBytes, 0};
+        for (const Moved& entry : moved) {
+            auto it = keyDir_.find(entry.key);
+            if (it != keyDir_.end() && it->second.fileId == entry.from.fileId &&
+                it->second.valueOffset == entry.from.valueOffset) {
+                it->second = entry.to;
+            } else {
+                // Overwritten or removed while merging; the copy is already garbage
+                mergedStats.deadBytes += kHeaderSize + entry.key.size() + entry.to.valueSize;
+            }
+        }
+        if (!moved.empty()) {
+            fds_[mergeId] = ::open(dataPath.c_str(), O_RDONLY);
+            fileStats_[mergeId] = mergedStats;
+        }
+        for (const auto& pair : sources) {
+            ::close(pair.second);
+            fds_.erase(pair.first);
+            fileStats_.erase(pair.first);
+            std::filesystem::remove(filePath(pair.first, ".data"));
+            std::filesystem::remove(filePath(pair.first, ".hint"));
+        }
+        return true;
+    }
+
+    // Start a background thread that merges whenever the dead-byte ratio exceeds the threshold,
+    // optionally pinned to the CPUs of a NUMA node
+    void startBackgroundMerge(std::chrono::milliseconds interval, double deadRatio = 0.5, int numaNode = -1) {
+        stopBackgroundMerge();
+        stopMerger_ = false;
+        merger_ = std::thread([this, interval, deadRatio, numaNode] {
+            if (numaNode >= 0) {
+                NumaTopology::instance().pinCurrentThread(numaNode);  // Keep merge work on one socket
+            }
+            std::unique_lock<std::mutex> lock(mergerMutex_);
+            while (!mergerCv_.wait_for(lock, interval, [this] { return stopMerger_; })) {
+                if (garbageRatio() >= deadRatio) {
+                    merge();
+                }
+            }
+        });
+    }
+
+    // Stop the background merge thread, if running
+    void stopBackgroundMerge() {
+        {
+            std::lock_guard<std::mutex> lock(mergerMutex_);
+            stopMerger_ = true;
+        }
+        mergerCv_.notify_all();
+        if (merger_.joinable()) {
+            merger_.join();
+        }
+    }
+
+    // Fraction of on-disk bytes that belong to overwritten or deleted records
+    double garbageRatio() {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        uint64_t total = 0, dead = 0;
+        for (const auto& pair : fileStats_) {
+            total += pair.second.totalBytes;
+            dead += pair.second.deadBytes;
+        }
+        return total == 0 ? 0.0 : static_cast<double>(dead) / static_cast<double>(total);
     }
 
 private:
-    std::unordered_map<std::string, std::string> db_;    // In-memory database
-    Storage storage_;                                     // Storage module for persistence
-    WAL wal_;                                             // WAL module for logging
-    std::shared_mutex mutex_;                             // Mutex for concurrency control
+    // Record layout: crc32 | keySize | valueSize | key | value (valueSize == kTombstone marks a delete)
+    static constexpr uint32_t kTombstone = UINT32_MAX;
+    static constexpr uint64_t kHeaderSize = 12;
+
+    struct KeyDirEntry {
+        uint64_t fileId;       // Data file holding the latest value
+        uint64_t valueOffset;  // Byte offset of the value inside that file
+        uint32_t valueSize;    // Length of the value
+    };
+
+    struct FileStats {
+        uint64_t totalBytes;
+        uint64_t deadBytes;
+    };
+
+    // A live record copied by a merge: where the key pointed when the merge started, and the copy
+    struct Moved {
+        std::string key;
+        KeyDirEntry from;
+        KeyDirEntry to;
+    };
+
+    std::string filePath(uint64_t id, const char* suffix) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%010llu", static_cast<unsigned long long>(id));
+        return (std::filesystem::path(dirName_) / (std::string(name) + suffix)).string();
+    }
+
+    static std::string encodeRecord(const std::string& key, const char* value, uint32_t valueSize) {
+        uint32_t keySize = static_cast<uint32_t>(key.size());
+        uint32_t payload = valueSize == kTombstone ? 0 : valueSize;
+        std::string record(kHeaderSize + keySize + payload, '\0');
+        std::memcpy(&record[4], &keySize, 4);
+        std::memcpy(&record[8], &valueSize, 4);
+        std::memcpy(&record[kHeaderSize], key.data(), keySize);
+        if (payload > 0) {
+            std::memcpy(&record[kHeaderSize + keySize], value, payload);
+        }
+        uint32_t crc = crc32(record.data() + 4, record.size() - 4);
+        std::memcpy(&record[0], &crc, 4);
+        return record;
+    }
+
+    static void appendHint(std::string& hints, const std::string& key, const KeyDirEntry& entry) {
+        uint32_t keySize = static_cast<uint32_t>(key.size());
+        hints.append(reinterpret_cast<const char*>(&keySize), 4);
+        hints.append(reinterpret_cast<const char*>(&entry.valueSize), 4);
+        hints.append(reinterpret_cast<const char*>(&entry.valueOffset), 8);
+        hints.append(key);
+    }
+
+    static bool preadFully(int fd, char* buf, size_t size, uint64_t offset) {
+        while (size > 0) {
+            ssize_t n = ::pread(fd, buf, size, static_cast<off_t>(offset));
+            if (n <= 0) {
+                return false;
+            }
+            buf += n;
+            size -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+
+    static bool writeFully(int fd, const std::string& data) {
+        const char* p = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = ::write(fd, p, left);
+            if (n <= 0) {
+                return false;
+            }
+            p += n;
+            left -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Append a record to the active file, rotating first if it is full; returns the record offset.
+    // Throws std::runtime_error, before the caller touches the key directory, if the write fails.
+    uint64_t appendRecord(const std::string& key, const char* value, uint32_t valueSize) {
+        if (activeSize_ >= maxFileSize_) {
+            openActiveFile(activeId_ + 2);
+        }
+        std::string record = encodeRecord(key, value, valueSize);
+        if (!writeFully(activeFd_, record)) {
+            std::string path = filePath(activeId_, ".data");
+            // Cut off a partial record so later offsets stay right; failing that, start a new file
+            if (::ftruncate(activeFd_, static_cast<off_t>(activeSize_)) != 0) {
+                openActiveFile(activeId_ + 2);
+            }
+            throw std::runtime_error("Cannot append to " + path);
+        }
+        uint64_t offset = activeSize_;
+        activeSize_ += record.size();
+        fileStats_[activeId_].totalBytes += record.size();
+        return offset;
+    }
+
+    void markDead(const std::string& key, const KeyDirEntry& entry) {
+        fileStats_[entry.fileId].deadBytes += kHeaderSize + key.size() + entry.valueSize;
+    }
+
+    void openActiveFile(uint64_t id) {
+        if (activeFd_ >= 0) {
+            ::close(activeFd_);
+        }
+        std::string path = filePath(id, ".data");
+        activeFd_ = ::open(path.c_str(), O_CREAT | O_WRONLY | O_APPEND, 0644);
+        fds_[id] = ::open(path.c_str(), O_RDONLY);
+        fileStats_[id];
+        activeId_ = id;
+        activeSize_ = 0;
+    }
+
+    // Rebuild the key directory in file-id order; returns the highest file id seen
+    uint64_t loadKeyDir() {
+        std::vector<uint64_t> ids;
+        for (const auto& file : std::filesystem::directory_iterator(dirName_)) {
+            if (file.path().extension() == ".data") {
+                ids.push_back(std::stoull(file.path().stem().string()));
+            } else if (file.path().extension() == ".tmp") {
+                std::filesystem::remove(file.path());  // Leftover of an interrupted merge
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+        for (uint64_t id : ids) {
+            fds_[id] = ::open(filePath(id, ".data").c_str(), O_RDONLY);
+            if (!loadHintFile(id)) {
+                loadDataFile(id);
+            }
+        }
+        return ids.empty() ? 0 : ids.back();
+    }
+
+    void applyLoaded(const std::string& key, const KeyDirEntry& entry, uint64_t recordSize) {
+        fileStats_[entry.fileId].totalBytes += recordSize;
+        auto it = keyDir_.find(key);
+        if (it != keyDir_.end()) {
+            markDead(key, it->second);
+        }
+        if (entry.valueSize == kTombstone) {
+            fileStats_[entry.fileId].deadBytes += recordSize;
+            if (it != keyDir_.end()) {
+                keyDir_.erase(it);
+            }
+        } else if (it != keyDir_.end()) {
+            it->second = entry;
+        } else {
+            keyDir_.emplace(key, entry);
+        }
+    }
+
+    // Load a merged file's entries from its hint file; false, with nothing loaded, unless the whole
+    // hint file parses and its entries cover the whole data file (the caller then scans the data)
+    bool loadHintFile(uint64_t id) {
+        std::ifstream hintFile(filePath(id, ".hint"), std::ios::binary);
+        if (!hintFile) {
+            return false;
+        }
+        std::vector<std::pair<std::string, KeyDirEntry>> entries;
+        uint64_t covered = 0;
+        uint32_t keySize, valueSize;
+        uint64_t valueOffset;
+        while (hintFile.read(reinterpret_cast<char*>(&keySize), 4)) {
+            std::string key(keySize, '\0');
+            if (!hintFile.read(reinterpret_cast<char*>(&valueSize), 4) ||
+                !hintFile.read(reinterpret_cast<char*>(&valueOffset), 8) || !hintFile.read(&key[0], keySize)) {
+                return false;  // Torn entry
+            }
+            covered += kHeaderSize + keySize + valueSize;
+            entries.emplace_back(std::move(key), KeyDirEntry{id, valueOffset, valueSize});
+        }
+        std::error_code ec;
+        if (hintFile.gcount() != 0 || covered != std::filesystem::file_size(filePath(id, ".data"), ec) || ec) {
+            return false;  // Torn, or truncated at an entry boundary
+        }
+        for (const auto& entry : entries) {
+            applyLoaded(entry.first, entry.second, kHeaderSize + entry.first.size() + entry.second.valueSize);
+        }
+        return true;
+    }
+
+    // Scan a data file record by record, stopping at the first torn or corrupt record
+    void loadDataFile(uint64_t id) {
+        std::ifstream dataFile(filePath(id, ".data"), std::ios::binary);
+        std::string record;
+        uint64_t offset = 0;
+        char header[kHeaderSize];
+        while (dataFile.read(header, kHeaderSize)) {
+            uint32_t crc, keySize, valueSize;
+            std::memcpy(&crc, header, 4);
+            std::memcpy(&keySize, header + 4, 4);
+            std::memcpy(&valueSize, header + 8, 4);
+            uint64_t payload = static_cast<uint64_t>(keySize) + (valueSize == kTombstone ? 0 : valueSize);
+            record.assign(header + 4, kHeaderSize - 4);
+            record.resize(kHeaderSize - 4 + payload);
+            if (!dataFile.read(&record[kHeaderSize - 4], static_cast<std::streamsize>(payload)) ||
+                crc32(record.data(), record.size()) != crc) {
+                break;
+            }
+            applyLoaded(record.substr(kHeaderSize - 4, keySize),
+                        KeyDirEntry{id, offset + kHeaderSize + keySize, valueSize}, kHeaderSize + payload);
+            offset += kHeaderSize + payload;
+        }
+    }
+
+    std::string dirName_;                                   // Directory holding data and hint files
+    uint64_t maxFileSize_;                                  // Rotation threshold for the active file
+    IOScheduler* scheduler_;                                // Optional scheduler that paces merges
+    std::unordered_map<std::string, KeyDirEntry> keyDir_;   // In-memory key directory
+    std::map<uint64_t, int> fds_;                           // Read descriptors for every data file
+    std::map<uint64_t, FileStats> fileStats_;               // Live/dead byte accounting per file
+    int activeFd_ = -1;                                     // Append descriptor of the active file
+    uint64_t activeId_ = 0;                                 // Id of the active file
+    uint64_t activeSize_ = 0;                               // Bytes written to the active file
+    std::shared_mutex mutex_;                               // Guards the key directory and files
+    std::mutex mergeMutex_;                                 // Serializes merges
+    std::thread merger_;                                    // Background merge thread
+    std::mutex mergerMutex_;
+    std::condition_variable mergerCv_;
+    bool stopMerger_ = false;
 };
 
 // Test Cases to Demonstrate the ExDB Functionality
+#ifndef EXDB_NO_MAIN  // Defined by the tests, which include this file
 int main() {
     // Initialize ExDB with database and WAL file names
     ExDB exdb("db.txt", "wal.txt");
@@ -147,8 +6960,20 @@ int main() {
     exdb.remove("name");
     std::cout << "name after deletion: " << exdb.get("name") << std::endl;
 
+    // Read and update part of a value
+    exdb.put("greeting", "HelloWorld");
+    exdb.setRange("greeting", 5, "There");
+    std::cout << "greeting: " << exdb.get("greeting") << ", first 5 bytes: " << exdb.getRange("greeting", 0, 5) << std::endl;
+
+    // Update individual fields of an object
+    exdb.hset("user:1", "name", "Bob");
+    exdb.hset("user:1", "city", "Paris");
+    exdb.hdel("user:1", "city");
+    std::cout << "user:1 name: " << exdb.hget("user:1", "name") << ", fields: " << exdb.hgetall("user:1").size() << std::endl;
+
     // Merge logs with the main database file
     exdb.mergeLogs();
 
     return 0;
 }
+#endif
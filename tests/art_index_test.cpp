@@ -0,0 +1,120 @@
+// ArtIndex tests: ordered scans, and lock-free gets racing concurrent puts and removes that grow,
+// shrink and split nodes and retire them for epoch reclamation.
+#define EXDB_NO_MAIN
+#include "../main.cpp"
+
+namespace {
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        throw std::runtime_error("check failed: " + what);
+    }
+}
+
+// Long keys with shared prefixes; writer w owns the ids congruent to w
+std::string keyFor(int id) {
+    return "tenant-" + std::to_string(id % 7) + "/users/" + std::to_string(id) + "/profile";
+}
+
+std::string valueFor(int id, int round) {
+    return "v" + std::to_string(id) + "." + std::to_string(round);
+}
+
+void testScans() {
+    ArtIndex index;
+    std::map<std::string, std::string> expected;
+    for (int id = 0; id < 2000; ++id) {
+        index.put(keyFor(id), valueFor(id, 0));
+        expected[keyFor(id)] = valueFor(id, 0);
+    }
+    for (int id = 0; id < 2000; id += 3) {
+        index.remove(keyFor(id));
+        expected.erase(keyFor(id));
+    }
+    index.put("tenant-1", "short");  // Ends inside the compressed path of other keys
+    expected["tenant-1"] = "short";
+    check(index.size() == expected.size(), "size counts the stored pairs");
+    std::vector<std::pair<std::string, std::string>> scanned;
+    index.scanPrefix("tenant-1", [&](const std::string& key, std::string_view value) {
+        scanned.emplace_back(key, std::string(value));
+        return true;
+    });
+    std::vector<std::pair<std::string, std::string>> wanted;
+    for (const auto& pair : expected) {
+        if (pair.first.compare(0, 8, "tenant-1") == 0) {
+            wanted.push_back(pair);
+        }
+    }
+    check(scanned == wanted, "scanPrefix visits the matching pairs in key order");
+}
+
+void testConcurrentAccess() {
+    ArtIndex index;
+    const int writers = 4;
+    const int readers = 4;
+    const int keysPerWriter = 3000;
+    const int rounds = 4;
+    std::atomic<bool> done{false};
+    std::atomic<int> badReads{0};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w] {
+            for (int round = 0; round < rounds; ++round) {
+                for (int i = 0; i < keysPerWriter; ++i) {
+                    int id = i * writers + w;
+                    index.put(keyFor(id), valueFor(id, round));
+                }
+                for (int i = 0; i < keysPerWriter; i += 2) {  // Shrinks and collapses nodes
+                    index.remove(keyFor(i * writers + w));
+                }
+            }
+        });
+    }
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::mt19937 random(static_cast<unsigned>(r));
+            while (!done.load()) {
+                int id = static_cast<int>(random() % (keysPerWriter * writers));
+                std::string value = index.get(keyFor(id));
+                std::string prefix = "v" + std::to_string(id) + ".";
+                if (value != "Key not found" && value.compare(0, prefix.size(), prefix) != 0) {
+                    ++badReads;  // A value of another key, or a freed leaf
+                }
+            }
+        });
+    }
+    for (int w = 0; w < writers; ++w) {
+        threads[static_cast<size_t>(w)].join();
+    }
+    done = true;
+    for (size_t t = writers; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    check(badReads == 0, "gets racing writers only see values of their own key");
+    for (int id = 0; id < keysPerWriter * writers; ++id) {
+        bool removed = (id / writers) % 2 == 0;
+        check(index.get(keyFor(id)) == (removed ? "Key not found" : valueFor(id, rounds - 1)),
+              "the final state of " + keyFor(id));
+    }
+    check(index.size() == static_cast<size_t>(keysPerWriter * writers / 2), "size after the race");
+}
+
+}  // namespace
+
+int main() {
+    const std::vector<std::pair<std::string, void (*)()>> tests = {
+        {"scans", testScans},
+        {"concurrent access", testConcurrentAccess},
+    };
+    int failures = 0;
+    for (const auto& test : tests) {
+        try {
+            test.second();
+            std::cout << "PASS " << test.first << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "FAIL " << test.first << ": " << e.what() << std::endl;
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
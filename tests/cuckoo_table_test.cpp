@@ -0,0 +1,92 @@
+// CuckooTable tests: lock-free gets racing concurrent puts, removes, displacements and resizes,
+// with replaced entries and bucket arrays freed through epoch reclamation.
+#define EXDB_NO_MAIN
+#include "../main.cpp"
+
+namespace {
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        throw std::runtime_error("check failed: " + what);
+    }
+}
+
+std::string keyFor(int id) {
+    return "key" + std::to_string(id);
+}
+
+std::string valueFor(int id, int round) {
+    return "v" + std::to_string(id) + "." + std::to_string(round);
+}
+
+void testConcurrentAccess() {
+    CuckooTable table(16);  // Starts small so that the writers force displacements and resizes
+    const int writers = 4;
+    const int readers = 4;
+    const int keysPerWriter = 20000;
+    const int rounds = 3;
+    std::atomic<bool> done{false};
+    std::atomic<int> badReads{0};
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; ++w) {
+        threads.emplace_back([&, w] {
+            for (int round = 0; round < rounds; ++round) {
+                for (int i = 0; i < keysPerWriter; ++i) {
+                    int id = i * writers + w;
+                    table.put(keyFor(id), valueFor(id, round));
+                }
+                for (int i = 0; i < keysPerWriter; i += 2) {
+                    table.remove(keyFor(i * writers + w));
+                }
+            }
+        });
+    }
+    for (int r = 0; r < readers; ++r) {
+        threads.emplace_back([&, r] {
+            std::mt19937 random(static_cast<unsigned>(r));
+            while (!done.load()) {
+                int id = static_cast<int>(random() % (keysPerWriter * writers));
+                std::string value = table.get(keyFor(id));
+                std::string prefix = "v" + std::to_string(id) + ".";
+                if (value != "Key not found" && value.compare(0, prefix.size(), prefix) != 0) {
+                    ++badReads;  // A value of another key, or a freed entry
+                }
+            }
+        });
+    }
+    for (int w = 0; w < writers; ++w) {
+        threads[static_cast<size_t>(w)].join();
+    }
+    done = true;
+    for (size_t t = writers; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    check(badReads == 0, "gets racing writers only see values of their own key");
+    for (int id = 0; id < keysPerWriter * writers; ++id) {
+        bool removed = (id / writers) % 2 == 0;
+        check(table.get(keyFor(id)) == (removed ? "Key not found" : valueFor(id, rounds - 1)),
+              "the final state of " + keyFor(id));
+    }
+    check(table.size() == static_cast<size_t>(keysPerWriter * writers / 2), "size after the race");
+    CuckooTable::Stats stats = table.stats();
+    check(stats.resizes > 0 && stats.displacements > 0, "the race displaced entries and resized the table");
+}
+
+}  // namespace
+
+int main() {
+    const std::vector<std::pair<std::string, void (*)()>> tests = {
+        {"concurrent access", testConcurrentAccess},
+    };
+    int failures = 0;
+    for (const auto& test : tests) {
+        try {
+            test.second();
+            std::cout << "PASS " << test.first << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "FAIL " << test.first << ": " << e.what() << std::endl;
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
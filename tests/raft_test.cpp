@@ -0,0 +1,227 @@
+// Raft tests: elections, partitions, log compaction and vote refusal after a restart, on clusters
+// running inside this process over a SimulatedNetwork.
+#define EXDB_NO_MAIN
+#include "../main.cpp"
+
+#include <optional>
+
+namespace {
+
+const std::filesystem::path testDir = std::filesystem::temp_directory_path() / "exdb_raft_test";
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        throw std::runtime_error("check failed: " + what);
+    }
+}
+
+// Poll a condition for up to five seconds
+bool eventually(const std::function<bool()>& condition) {
+    for (int tries = 0; tries < 500; ++tries) {
+        if (condition()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+std::unique_ptr<ExDB> startNode(SimulatedNetwork& network, int id, int clusterSize) {
+    ExDBOptions options;
+    options.raft.nodeId = id;
+    for (int peer = 0; peer < clusterSize; ++peer) {
+        if (peer != id) {
+            options.raft.peers.push_back(peer);
+        }
+    }
+    options.raft.network = &network;
+    options.raft.syncLog = false;
+    std::string prefix = (testDir / ("node" + std::to_string(id))).string();
+    return std::make_unique<ExDB>(prefix + ".db", prefix + ".wal", options);
+}
+
+// Index of the only node that leads and can confirm it, or -1
+int findLeader(std::vector<std::unique_ptr<ExDB>>& nodes) {
+    int leader = -1;
+    eventually([&] {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i] && nodes[i]->raftStatus().role == RaftStatus::Role::Leader) {
+                try {
+                    nodes[i]->linearizableGet("probe");
+                    leader = static_cast<int>(i);
+                    return true;
+                } catch (const std::runtime_error&) {
+                }
+            }
+        }
+        return false;
+    });
+    return leader;
+}
+
+bool applied(ExDB& node, uint64_t index) {
+    return eventually([&] { return node.raftStatus().lastApplied >= index; });
+}
+
+void testElectionAndReplication() {
+    SimulatedNetwork network;
+    std::vector<std::unique_ptr<ExDB>> nodes;
+    for (int id = 0; id < 3; ++id) {
+        nodes.push_back(startNode(network, id, 3));
+    }
+    int leader = findLeader(nodes);
+    check(leader >= 0, "a leader is elected");
+    uint64_t term = nodes[leader]->raftStatus().term;
+    for (const auto& node : nodes) {
+        RaftStatus status = node->raftStatus();
+        check(status.term != term || status.role != RaftStatus::Role::Leader || node == nodes[leader],
+              "one leader per term");
+    }
+    uint64_t index = nodes[leader]->put("key", "value");
+    nodes[leader]->hset("map", "field", "1");
+    int follower = (leader + 1) % 3;
+    bool rejected = false;
+    try {
+        nodes[follower]->put("key", "other");
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    check(rejected, "followers reject writes");
+    for (const auto& node : nodes) {
+        check(applied(*node, index + 1), "every node applies the writes");
+        check(node->get("key") == "value" && node->hget("map", "field") == "1", "every node has the writes");
+    }
+}
+
+void testPartitionedLeader() {
+    SimulatedNetwork network;
+    std::vector<std::unique_ptr<ExDB>> nodes;
+    for (int id = 0; id < 3; ++id) {
+        nodes.push_back(startNode(network, id, 3));
+    }
+    int oldLeader = findLeader(nodes);
+    check(oldLeader >= 0, "a leader is elected");
+    uint64_t oldTerm = nodes[oldLeader]->raftStatus().term;
+    nodes[oldLeader]->put("before", "partition");
+    network.isolate(oldLeader);
+    check(eventually([&] { return nodes[oldLeader]->raftStatus().role != RaftStatus::Role::Leader; }),
+          "a leader cut off from the majority steps down");
+    bool rejected = false;
+    try {
+        nodes[oldLeader]->put("lost", "write");
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    check(rejected, "the isolated node rejects writes");
+    std::unique_ptr<ExDB> isolated = std::move(nodes[oldLeader]);
+    int newLeader = findLeader(nodes);
+    check(newLeader >= 0 && nodes[newLeader]->raftStatus().term > oldTerm, "the majority elects a leader in a later term");
+    uint64_t index = nodes[newLeader]->put("after", "partition");
+    nodes[oldLeader] = std::move(isolated);
+    network.heal();
+    check(applied(*nodes[oldLeader], index), "the old leader catches up after the partition heals");
+    check(nodes[oldLeader]->get("after") == "partition" && nodes[oldLeader]->get("before") == "partition" &&
+          nodes[oldLeader]->get("lost") == "Key not found", "the old leader has the majority's log");
+}
+
+void testCompactionAndSnapshot() {
+    SimulatedNetwork network;
+    std::vector<std::unique_ptr<ExDB>> nodes;
+    for (int id = 0; id < 3; ++id) {
+        nodes.push_back(startNode(network, id, 3));
+    }
+    int leader = findLeader(nodes);
+    check(leader >= 0, "a leader is elected");
+    int lagging = (leader + 1) % 3;
+    network.isolate(lagging);
+    for (int i = 0; i < 200; ++i) {
+        nodes[leader]->put("key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    uint64_t index = nodes[leader]->put("last", "write");
+    nodes[leader]->mergeLogs();
+    check(nodes[leader]->raftStatus().snapshotIndex >= index, "mergeLogs compacts the log");
+    network.heal();
+    check(applied(*nodes[lagging], index), "the lagging node catches up");
+    check(nodes[lagging]->raftStatus().snapshotIndex > 0, "the lagging node installs the snapshot");
+    check(nodes[lagging]->get("key0") == "value0" && nodes[lagging]->get("last") == "write",
+          "the snapshot carries the table");
+}
+
+// Replies of a node to a fake candidate attached to the network
+struct VoteProbe {
+    std::mutex mutex;
+    std::condition_variable replied;
+    std::optional<bool> granted;
+};
+
+bool requestVote(SimulatedNetwork& network, VoteProbe& probe, int candidate, int voter, uint64_t term) {
+    {
+        std::lock_guard<std::mutex> lock(probe.mutex);
+        probe.granted.reset();
+    }
+    RaftMessage request;
+    request.type = RaftMessage::Type::RequestVote;
+    request.from = candidate;
+    request.to = voter;
+    request.term = term;
+    request.index = 1000;  // A log at least as long as the voter's
+    request.logTerm = term;
+    network.send(request);
+    std::unique_lock<std::mutex> lock(probe.mutex);
+    check(probe.replied.wait_for(lock, std::chrono::seconds(1), [&] { return probe.granted.has_value(); }),
+          "the voter answers");
+    return *probe.granted;
+}
+
+void testNoVotesRightAfterRestart() {
+    SimulatedNetwork network;
+    const int voter = 0;
+    const int candidate = 1;
+    VoteProbe probe;
+    network.attach(candidate, [&](const RaftMessage& message) {
+        if (message.type == RaftMessage::Type::Vote) {
+            std::lock_guard<std::mutex> lock(probe.mutex);
+            probe.granted = message.success;
+            probe.replied.notify_all();
+        }
+    });
+    RaftOptions options;
+    options.nodeId = voter;
+    options.peers = {candidate};
+    options.network = &network;
+    options.syncLog = false;
+    options.electionTimeout = std::chrono::milliseconds(200);
+    std::string prefix = (testDir / "voter").string();
+    RaftNode node(options, prefix + ".raft", prefix + ".raftstate", [](uint64_t, const std::string&) {},
+                  [](std::string&) { return uint64_t{0}; }, [](uint64_t, const std::string&) {});
+    node.start();
+    check(!requestVote(network, probe, candidate, voter, 100), "a freshly started node refuses to vote");
+    std::this_thread::sleep_for(options.electionTimeout + std::chrono::milliseconds(50));
+    check(requestVote(network, probe, candidate, voter, 200), "it votes once an election timeout has passed");
+    network.detach(candidate);
+}
+
+}  // namespace
+
+int main() {
+    const std::vector<std::pair<std::string, void (*)()>> tests = {
+        {"election and replication", testElectionAndReplication},
+        {"partitioned leader", testPartitionedLeader},
+        {"compaction and snapshot", testCompactionAndSnapshot},
+        {"no votes right after restart", testNoVotesRightAfterRestart},
+    };
+    int failures = 0;
+    for (const auto& test : tests) {
+        std::filesystem::remove_all(testDir);
+        std::filesystem::create_directories(testDir);
+        try {
+            test.second();
+            std::cout << "PASS " << test.first << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "FAIL " << test.first << ": " << e.what() << std::endl;
+            ++failures;
+        }
+    }
+    std::filesystem::remove_all(testDir);
+    return failures == 0 ? 0 : 1;
+}
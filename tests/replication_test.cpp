@@ -0,0 +1,130 @@
+// Replication tests: a leader and its followers as ExDB instances inside this process, connected
+// over Unix sockets in a temporary directory.
+#define EXDB_NO_MAIN
+#include "../main.cpp"
+
+namespace {
+
+const std::filesystem::path testDir = std::filesystem::temp_directory_path() / "exdb_replication_test";
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        throw std::runtime_error("check failed: " + what);
+    }
+}
+
+// Poll a condition for up to five seconds
+bool eventually(const std::function<bool()>& condition) {
+    for (int tries = 0; tries < 500; ++tries) {
+        if (condition()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+std::string socketPath(const std::string& name) {
+    return (testDir / (name + ".sock")).string();
+}
+
+std::unique_ptr<ExDB> startLeader(const std::vector<std::string>& followers) {
+    ExDBOptions options;
+    for (const std::string& follower : followers) {
+        options.replication.followers.push_back(socketPath(follower));
+    }
+    std::string prefix = (testDir / "leader").string();
+    return std::make_unique<ExDB>(prefix + ".db", prefix + ".wal", options);
+}
+
+std::unique_ptr<ExDB> startFollower(const std::string& name) {
+    ExDBOptions options;
+    options.replication.listenSocket = socketPath(name);
+    std::string prefix = (testDir / name).string();
+    return std::make_unique<ExDB>(prefix + ".db", prefix + ".wal", options);
+}
+
+bool has(ExDB& node, const std::string& key, const std::string& value) {
+    return eventually([&] { return node.get(key) == value; });
+}
+
+void testNewFollowerGetsExistingData() {
+    std::unique_ptr<ExDB> leader = startLeader({"follower"});
+    leader->put("a", "1");
+    leader->put("b", "2");
+    leader->remove("b");
+    leader->hset("map", "field", "3");
+    std::unique_ptr<ExDB> follower = startFollower("follower");
+    check(has(*follower, "a", "1"), "a follower started after writes receives them");
+    check(follower->get("b") == "Key not found" && follower->hget("map", "field") == "3",
+          "the follower has the leader's table");
+    check(eventually([&] { return leader->replicationStats().reseeds == 1; }), "the leader sends one copy");
+    uint64_t token = leader->put("c", "4");
+    check(eventually([&] {
+              try {
+                  return follower->get("c", token) == "4";
+              } catch (const std::runtime_error&) {
+                  return false;
+              }
+          }),
+          "later writes follow the copy");
+}
+
+void testLeaderRestart() {
+    auto leader = startLeader({"follower"});
+    auto follower = startFollower("follower");
+    leader->put("kept", "1");
+    leader->put("changed", "old");
+    leader->put("deleted", "x");
+    check(has(*follower, "deleted", "x"), "the follower applies the writes");
+    follower.reset();  // Out of contact while the leader changes and restarts
+    leader->put("changed", "new");
+    leader->remove("deleted");
+    leader.reset();
+    leader = startLeader({"follower"});
+    follower = startFollower("follower");
+    check(has(*follower, "changed", "new"), "a change missed before the leader restarted arrives");
+    check(follower->get("deleted") == "Key not found" && follower->get("kept") == "1",
+          "the follower's table matches the restarted leader");
+    leader.reset();  // Restart the leader with the follower running
+    leader = startLeader({"follower"});
+    leader->put("after", "restart");
+    check(has(*follower, "after", "restart"), "writes after the restart reach the follower");
+    check(follower->get("changed") == "new", "the follower keeps the data across the new copy");
+}
+
+void testFollowerRestartResumes() {
+    auto leader = startLeader({"follower"});
+    auto follower = startFollower("follower");
+    leader->put("first", "1");
+    check(has(*follower, "first", "1"), "the follower applies the write");
+    follower.reset();
+    leader->put("second", "2");
+    follower = startFollower("follower");
+    check(has(*follower, "second", "2"), "a restarted follower receives what it missed");
+    check(leader->replicationStats().reseeds == 1, "it resumes from the backlog without another copy");
+}
+
+}  // namespace
+
+int main() {
+    const std::vector<std::pair<std::string, void (*)()>> tests = {
+        {"new follower gets existing data", testNewFollowerGetsExistingData},
+        {"leader restart", testLeaderRestart},
+        {"follower restart resumes", testFollowerRestartResumes},
+    };
+    int failures = 0;
+    for (const auto& test : tests) {
+        std::filesystem::remove_all(testDir);
+        std::filesystem::create_directories(testDir);
+        try {
+            test.second();
+            std::cout << "PASS " << test.first << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << "FAIL " << test.first << ": " << e.what() << std::endl;
+            ++failures;
+        }
+    }
+    std::filesystem::remove_all(testDir);
+    return failures == 0 ? 0 : 1;
+}